@@ -0,0 +1,123 @@
+##############################################################################
+## This file is part of 'tpg'.
+## It is subject to the license terms in the LICENSE.txt file found in the
+## top-level directory of this distribution and at:
+##    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+## No part of 'tpg', including this file,
+## may be copied, modified, propagated, or distributed except according to
+## the terms contained in the LICENSE.txt file.
+##############################################################################
+#
+#  Generate a header of constexpr register descriptors (Cphw::RegDesc)
+#  from the CPSW yaml register maps.  Each top-level MMIODev block with
+#  IntField children becomes a namespace Cphw::Regs::<block>.  Blocks that
+#  appear in more than one tree are merged; a register described
+#  differently in two trees is an error.
+#
+#  Usage: python3 yaml_regmap.py -o <header> <top.yaml> [<top.yaml> ...]
+#
+import argparse
+import os
+import sys
+import yaml
+
+MODES = { 'RO':'RO', 'RW':'RW', 'WO':'WO' }
+
+def preprocess(fname, done=None):
+    #  Resolve the CPSW '#include' and '#once' directives into one document
+    if done is None:
+        done = set()
+    path = os.path.abspath(fname)
+    if path in done:
+        return ''
+    done.add(path)
+    text = ''
+    body = ''
+    with open(path) as f:
+        for line in f:
+            if line.startswith('#include'):
+                text += preprocess(os.path.join(os.path.dirname(path),
+                                                line.split()[1]), done)
+            else:
+                body += line
+    return text + body
+
+def registers(block):
+    regs = []
+    for name, child in block.get('children', {}).items():
+        if not isinstance(child, dict) or child.get('class') != 'IntField':
+            continue
+        at = child.get('at', {})
+        regs.append((name,
+                     int(at.get('offset', 0)),
+                     int(child.get('sizeBits', 32)),
+                     int(child.get('lsBit', 0)),
+                     int(at.get('nelms', 1)),
+                     int(at.get('stride', 0)),
+                     MODES[child.get('mode', 'RW')]))
+    return sorted(regs, key=lambda r: (r[1], r[3], r[0]))
+
+def collect(files):
+    blocks = {}
+    for fname in files:
+        doc = yaml.safe_load(preprocess(fname))
+        for bname, block in doc.items():
+            if not isinstance(block, dict) or block.get('class') != 'MMIODev':
+                continue
+            regs = registers(block)
+            if not regs:
+                continue
+            merged = blocks.setdefault(bname, {})
+            for r in regs:
+                if r[0] in merged and merged[r[0]] != r:
+                    sys.exit('%s: register %s/%s is described differently in two trees'%
+                             (fname, bname, r[0]))
+                merged[r[0]] = r
+    return blocks
+
+def emit(blocks, files, out):
+    out.write('//////////////////////////////////////////////////////////////////////////////\n')
+    out.write('// This file is part of \'tpg\'.\n')
+    out.write('// It is subject to the license terms in the LICENSE.txt file found in the \n')
+    out.write('// top-level directory of this distribution and at: \n')
+    out.write('//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. \n')
+    out.write('// No part of \'tpg\', including this file, \n')
+    out.write('// may be copied, modified, propagated, or distributed except according to \n')
+    out.write('// the terms contained in the LICENSE.txt file.\n')
+    out.write('//////////////////////////////////////////////////////////////////////////////\n')
+    out.write('//\n')
+    out.write('//  Generated by scripts/yaml_regmap.py from\n')
+    for f in files:
+        out.write('//    %s\n'%f)
+    out.write('//  Do not edit; make regenerates it when the yaml changes.\n')
+    out.write('//\n')
+    out.write('#ifndef hps_regmap_hh\n')
+    out.write('#define hps_regmap_hh\n\n')
+    out.write('#include "regmap.hh"\n\n')
+    out.write('namespace Cphw {\n')
+    out.write('  namespace Regs {\n')
+    for bname in sorted(blocks):
+        regs = sorted(blocks[bname].values(), key=lambda r: (r[1], r[3], r[0]))
+        w = max(len(r[0]) for r in regs)
+        out.write('    namespace %s {\n'%bname)
+        out.write('      enum { NREGS = %d };\n'%len(regs))
+        for i, r in enumerate(regs):
+            out.write('      constexpr RegDesc %-*s = { %3d, %-*s, %10d, RegDesc::%s };  // 0x%08x\n'%
+                      (w, r[0], i, w+2, '"%s"'%r[0], r[4], r[6], r[1]))
+        out.write('    };\n')
+    out.write('  };\n')
+    out.write('};\n\n')
+    out.write('#endif\n')
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Generate register descriptors from CPSW yaml')
+    parser.add_argument('-o', '--output', default='-', help='output header')
+    parser.add_argument('files', nargs='+', help='top-level yaml files')
+    args = parser.parse_args()
+
+    blocks = collect(args.files)
+    if args.output == '-':
+        emit(blocks, args.files, sys.stdout)
+    else:
+        with open(args.output, 'w') as out:
+            emit(blocks, args.files, out)
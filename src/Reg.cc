@@ -15,168 +15,972 @@
 #include <unistd.h>
 #include <poll.h>
 #include <stdlib.h>
-#include <semaphore.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <algorithm>
+#include <deque>
+#include <vector>
 
 //#define DBUG
 
-static unsigned _fd;
-static unsigned _context=0;
-static unsigned _mem;
-static sem_t    _sem;
+//
+//  Requests are [context, addr|op, data.., 0] for writes and [context,
+//  addr, nwords-1, 0] for reads; the response echoes the header and the
+//  data written or read, followed by a status word.  The context carries
+//  a transaction tag, (sequence<<8)|slot, so that several requests may be
+//  outstanding and their responses matched in any order.
+//
+//  Each transaction is resent independently when its own timeout expires.
+//  The timeout follows RFC 6298: smoothed round trip time plus four times
+//  its variation, sampled only from transactions answered on the first
+//  try (Karn), and doubled on each retry.
+//
+//  Threads sharing a socket post their requests into the same window.
+//  One waiting thread at a time receives; it completes each response's
+//  transaction by its tag and wakes the others.
+//
+static const uint32_t WRITE       = 0x40000000;
+static const unsigned MAX_WINDOW  = 256;
+//  Data words per datagram within a 1500 byte MTU
+static const unsigned MAX_WORDS   = (1500-28)/4-3;
+//  Retransmission timeouts [ns]
+static const uint64_t INITIAL_RTO =  20000000;
+static const uint64_t MIN_RTO     =   1000000;
+static const uint64_t MAX_RTO     = 250000000;
+//  Each connection's registers occupy their own range of the address space
+static const unsigned SPACE_SHIFT = 36;
+static const unsigned MAX_CONNECTIONS = 256;
 
-using namespace Pds::Cphw;
+using Pds::Cphw::Reg;
+using Pds::Cphw::RegConnection;
 
-void Reg::setBit  (unsigned b)
+namespace {
+  //  Accesses of one call, completed together
+  class Group {
+  public:
+    Group() : pending(0), failed(0), status(Reg::Success) {}
+  public:
+    unsigned pending;
+    unsigned failed;
+    int      status;
+  };
+
+  class Request {
+  public:
+    uint32_t        addr;    // word address | WRITE
+    unsigned        n;       // words
+    uint32_t        value;   // write data if n==1 and !src
+    const uint32_t* src;     // write data
+    uint32_t*       dst;     // read destination
+    Group*          group;   // 0 for accesses completed by flush()
+  };
+
+  class Transaction {
+  public:
+    Request   req;
+    uint32_t  tid;
+    unsigned  tries;
+    uint64_t  sent;     // ns
+    uint64_t  rto;      // ns
+    bool      busy;
+    uint32_t  lastTid;  // most recently finished in this slot
+    bool      lastOk;
+  };
+
+  class Transport {
+  public:
+    Transport(unsigned window, unsigned tries);
+    ~Transport();
+  public:
+    int      open    (const sockaddr_in&);
+    void     lock    () { pthread_mutex_lock  (&_lock); }
+    void     unlock  () { pthread_mutex_unlock(&_lock); }
+    //  The following with the lock held
+    void     post    (const Request&);
+    //  Until the group's accesses (or, with 0, all accesses) complete
+    int      wait    (Group*);
+    void     stats   (Reg::Stats&, bool reset);
+  public:
+    unsigned window;
+    unsigned tries;
+    void*    owner;
+  private:
+    int      _drive  ();
+    int      _pump   (uint64_t now);
+    int      _send   (Transaction&, uint64_t now);
+    int      _receive();
+    void     _expire (uint64_t now);
+    void     _finish (Transaction&, bool ok, int status);
+    void     _sample (uint64_t rtt);
+    void     _abort  (int status);
+  private:
+    int                  _fd;
+    pthread_mutex_t      _lock;
+    pthread_cond_t       _cv;
+    bool                 _driving;
+    std::deque<Request>  _queue;
+    Transaction          _slots[MAX_WINDOW];
+    std::vector<uint8_t> _free;
+    unsigned             _inflight;
+    uint32_t             _seq;
+    int                  _status;   // of accesses completed by flush()
+    bool                 _down;
+    uint64_t             _srtt;
+    uint64_t             _rttvar;
+    uint64_t             _rto;
+    Reg::Stats           _stats;
+  };
+};
+
+static uint64_t _now()
 {
-  unsigned r = *this;
-  *this = r | (1<<b);
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return uint64_t(ts.tv_sec)*1000000000ULL + ts.tv_nsec;
 }
 
-void Reg::clearBit(unsigned b)
+static void _clear(Reg::Stats& s)
 {
-  unsigned r = *this;
-  *this = r &~(1<<b);
+  memset(&s, 0, sizeof(s));
 }
 
-void Reg::set(const char* host,
-              unsigned short port,
-              unsigned mem,
-              unsigned long long memsz)
+static void _add(Reg::Stats& s, const Reg::Stats& t)
 {
-  unsigned ip = ntohl(inet_addr(host));
-  _fd = ::socket(AF_INET, SOCK_DGRAM, 0);
-  struct sockaddr_in saddr;
-  saddr.sin_family      = AF_INET;
-  saddr.sin_addr.s_addr = htonl(ip);
-  saddr.sin_port        = htons(port);
-  socklen_t addrlen = sizeof(saddr);
-  ::connect(_fd, reinterpret_cast<const sockaddr*>(&saddr), addrlen);
-  _mem = mem;
+  s.requests   += t.requests;
+  s.datagrams  += t.datagrams;
+  s.retries    += t.retries;
+  s.timeouts   += t.timeouts;
+  s.late       += t.late;
+  s.duplicates += t.duplicates;
+  s.errors     += t.errors;
+}
 
-  sem_init(&_sem,0,1);
+Transport::Transport(unsigned w, unsigned t) :
+  window   (w),
+  tries    (t),
+  owner    (0),
+  _fd      (-1),
+  _driving (false),
+  _inflight(0),
+  _seq     (0),
+  _status  (Reg::Success),
+  _down    (false),
+  _srtt    (0),
+  _rttvar  (0),
+  _rto     (INITIAL_RTO)
+{
+  pthread_mutex_init(&_lock, 0);
+  pthread_cond_init (&_cv, 0);
+  for(unsigned i=0; i<MAX_WINDOW; i++) {
+    _slots[i].busy    = false;
+    _slots[i].lastTid = 0;
+    _free.push_back(MAX_WINDOW-1-i);
+  }
+  _clear(_stats);
 }
 
-Reg& Reg::operator=(const unsigned r)
+Transport::~Transport()
 {
-  uint32_t addr = ((_mem+uint64_t(this))>>2)&0x3fffffff; 
-  uint32_t tbuff[4];
-  tbuff[0] = _context;
-  tbuff[1] = addr | 0x40000000;
-  tbuff[2] = r;
-  tbuff[3] = 0;
+  if (_fd >= 0)
+    ::close(_fd);
+  pthread_cond_destroy (&_cv);
+  pthread_mutex_destroy(&_lock);
+}
 
-  int tmo = 20;
+int Transport::open(const sockaddr_in& saddr)
+{
+  _fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+  if (_fd < 0) {
+    perror("Reg: socket");
+    return Reg::SocketError;
+  }
+  if (::connect(_fd, reinterpret_cast<const sockaddr*>(&saddr), sizeof(saddr)) < 0) {
+    perror("Reg: connect");
+    ::close(_fd);
+    _fd = -1;
+    return Reg::SocketError;
+  }
+  return Reg::Success;
+}
 
-  sem_wait(&_sem);
+void Transport::stats(Reg::Stats& s, bool reset)
+{
+  s = _stats;
+  s.srttNs   = _srtt;
+  s.rttvarNs = _rttvar;
+  s.rtoNs    = _rto;
+  if (reset)
+    _clear(_stats);
+}
 
-  for(unsigned i=0; i<10; i++) {
-#ifdef DBUG
-    printf("Send %08x %08x %08x %08x\n",
-           tbuff[0],tbuff[1],tbuff[2],tbuff[3]);
-#endif
-    ::send(_fd, tbuff, sizeof(tbuff), 0);
+//  RFC 6298 (2.2), (2.3) with alpha 1/8, beta 1/4
+void Transport::_sample(uint64_t rtt)
+{
+  if (_srtt == 0) {
+    _srtt   = rtt;
+    _rttvar = rtt/2;
+  }
+  else {
+    uint64_t d = rtt > _srtt ? rtt-_srtt : _srtt-rtt;
+    _rttvar = (3*_rttvar + d)/4;
+    _srtt   = (7*_srtt + rtt)/8;
+  }
+  _rto = _srtt + 4*_rttvar;
+  if (_rto < MIN_RTO) _rto = MIN_RTO;
+  if (_rto > MAX_RTO) _rto = MAX_RTO;
+}
 
-    pollfd pfd;
-    pfd.fd = _fd;
-    pfd.events = POLLIN | POLLERR;
+static const uint32_t* _data(const Request& r)
+{
+  return r.src ? r.src : &r.value;
+}
 
-    int pv = poll(&pfd, 1, tmo);
-    if (pv < 0) {
-      printf("Reg: Error on socket %d\n",_fd);
-      exit(1);
+int Transport::_send(Transaction& t, uint64_t now)
+{
+  uint32_t tbuff[MAX_WORDS+3];
+  unsigned n = 2;
+  tbuff[0] = t.tid;
+  tbuff[1] = t.req.addr;
+  if (t.req.addr & WRITE) {
+    const uint32_t* d = _data(t.req);
+    for(unsigned i=0; i<t.req.n; i++)
+      tbuff[n++] = d[i];
+  }
+  else
+    tbuff[n++] = t.req.n-1;
+  tbuff[n++] = 0;
+#ifdef DBUG
+  printf("Send %08x %08x %08x %08x [%u]\n",
+         tbuff[0],tbuff[1],tbuff[2],tbuff[3],n);
+#endif
+  t.sent = now;
+  t.tries++;
+  _stats.datagrams++;
+  if (::send(_fd, tbuff, n*sizeof(uint32_t), 0) < 0) {
+    //  Treated as a lost datagram; ECONNREFUSED is a previous
+    //  request's ICMP port unreachable
+    if (errno != ENOBUFS && errno != EAGAIN && errno != ECONNREFUSED) {
+      perror("Reg: send");
+      return Reg::SocketError;
     }
+  }
+  return Reg::Success;
+}
 
-    if (pv==0) {
-      fprintf(stderr,"[Reg: timeout %d]",i+1);
-      continue;
+void Transport::_finish(Transaction& t, bool ok, int status)
+{
+  if (!ok)
+    _stats.timeouts++;
+  if (t.req.group) {
+    t.req.group->pending--;
+    if (!ok) {
+      t.req.group->failed++;
+      t.req.group->status = status;
     }
+  }
+  else if (!ok)
+    _status = status;
+  t.busy    = false;
+  t.lastTid = t.tid;
+  t.lastOk  = ok;
+  _free.push_back(t.tid & (MAX_WINDOW-1));
+  _inflight--;
+}
 
-    uint32_t rbuff[4];
-    int ret = ::read(_fd, rbuff, sizeof(rbuff));
+int Transport::_receive()
+{
+  uint32_t rbuff[MAX_WORDS+3];
+  int ret;
+  while((ret = ::recv(_fd, rbuff, sizeof(rbuff), MSG_DONTWAIT)) >= 0) {
 #ifdef DBUG
     printf("Recv %08x %08x %08x %08x [%d]\n",
-	 rbuff[0],rbuff[1],rbuff[2],rbuff[3],ret);
+           rbuff[0],rbuff[1],rbuff[2],rbuff[3],ret);
 #endif
-    if (ret      != sizeof(rbuff) ||
-	rbuff[0] != _context ||
-	(rbuff[1]^(1<<30)) != addr) {
+    if (ret < int(3*sizeof(uint32_t))) {
+      _stats.errors++;
+      continue;
+    }
+    Transaction& t = _slots[rbuff[0] & (MAX_WINDOW-1)];
+    if (!t.busy || rbuff[0] != t.tid) {
+      //  Answer to a retry of a completed transaction, or to one given up
+      if (rbuff[0] == t.lastTid && t.lastOk)
+        _stats.duplicates++;
+      else
+        _stats.late++;
+      continue;
+    }
+    if (ret != int((t.req.n+3)*sizeof(uint32_t)) ||
+        rbuff[1] != t.req.addr) {
+#ifdef DBUG
       printf("Error reading [%x,%x]/[%x,%x] %d bytes, retry %d\n",
-	     rbuff[0], rbuff[1], _context, addr, ret, i+1);
+             rbuff[0], rbuff[1], t.tid, t.req.addr, ret, t.tries);
+#endif
+      _stats.errors++;
       continue;
     }
 
-    if (rbuff[2] != r) {
-      printf("Ack error %08x:%08x\n",rbuff[2],r);
+    if (t.req.addr & WRITE) {
+      const uint32_t* d = _data(t.req);
+      unsigned i=0;
+      while(i<t.req.n && rbuff[i+2]==d[i])
+        i++;
+      if (i < t.req.n) {
+#ifdef DBUG
+        printf("Ack error %08x:%08x\n",rbuff[i+2],d[i]);
+#endif
+        _stats.errors++;
+        t.sent = 0;  // resend
+        continue;
+      }
+    }
+    else
+      for(unsigned i=0; i<t.req.n; i++)
+        t.req.dst[i] = rbuff[i+2];
+
+    if (t.tries == 1)
+      _sample(_now()-t.sent);
+
+    _finish(t, true, Reg::Success);
+  }
+
+  if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNREFUSED)
+    return Reg::Success;
+  perror("Reg: recv");
+  return Reg::SocketError;
+}
+
+void Transport::_expire(uint64_t now)
+{
+  for(unsigned i=0; i<MAX_WINDOW; i++) {
+    Transaction& t = _slots[i];
+    if (!t.busy || now < t.sent+t.rto)
+      continue;
+    if (t.tries >= tries) {
+      printf("Reg[%08x]::%s[%u] FAILED\n", (t.req.addr&~WRITE)<<2,
+             (t.req.addr&WRITE) ? "write" : "read", t.req.n);
+      _finish(t, false, Reg::Timeout);
+      _down = true;
       continue;
     }
-    sem_post(&_sem);
-    return *this;
+    if (t.sent) {
+      _stats.retries++;
+      t.rto = 2*t.rto < MAX_RTO ? 2*t.rto : MAX_RTO;
+    }
+    _send(t, now);
   }
+}
 
-  printf("Reg[%p]::operator=[%08x]  FAILED\n",this,r);
-  sem_post(&_sem);
-  return *this;
+//  Fail everything outstanding
+void Transport::_abort(int status)
+{
+  unsigned n = _inflight + _queue.size();
+  if (n)
+    printf("Reg: %u transactions abandoned\n", n);
+  for(unsigned i=0; i<MAX_WINDOW; i++)
+    if (_slots[i].busy)
+      _finish(_slots[i], false, status);
+  while(!_queue.empty()) {
+    Request& r = _queue.front();
+    if (r.group) {
+      r.group->pending--;
+      r.group->failed++;
+      r.group->status = status;
+    }
+    else
+      _status = status;
+    _stats.timeouts++;
+    _queue.pop_front();
+  }
 }
 
-Reg::operator unsigned() const
+//  Send queued requests into the window
+int Transport::_pump(uint64_t now)
 {
-  // semaphore
-  // sendmsg to read register
-  // recvmsg for value
-  // return value
-  uint32_t addr = ((_mem+uint64_t(this))>>2)&0x3fffffff; 
-  uint32_t tbuff[4];
-  tbuff[0] = _context;
-  tbuff[1] = addr;
-  tbuff[2] = 0;
-  tbuff[3] = 0;
+  while(_inflight < window && !_queue.empty()) {
+    Transaction& t = _slots[_free.back()];
+    _free.pop_back();
+    t.req   = _queue.front();
+    t.tid   = ((++_seq)<<8) | (&t - _slots);
+    t.tries = 0;
+    t.rto   = _rto;
+    t.busy  = true;
+    _inflight++;
+    _queue.pop_front();
+    if (_send(t, now) < 0)
+      return Reg::SocketError;
+  }
+  return Reg::Success;
+}
 
-  int tmo = 20;
+void Transport::post(const Request& r)
+{
+  if (r.group)
+    r.group->pending++;
+  _queue.push_back(r);
+  _stats.requests++;
+  if (_fd >= 0)
+    _pump(_now());
+}
 
-  sem_wait(&_sem);
+//  One wait for responses or the earliest timeout, with the lock released
+int Transport::_drive()
+{
+  uint64_t now = _now();
+  if (_pump(now) < 0)
+    return Reg::SocketError;
 
-  for(unsigned i=0; i<10; i++) {
-#ifdef DBUG
-    printf("Send %08x %08x %08x %08x\n",
-	   tbuff[0],tbuff[1],tbuff[2],tbuff[3]);
-#endif
-    ::send(_fd, tbuff, sizeof(tbuff), 0);
-
-    pollfd pfd;
-    pfd.fd = _fd;
-    pfd.events = POLLIN | POLLERR;
-    
-    int pv = poll(&pfd, 1, tmo);
-    if (pv < 0) {
-      printf("Reg: Error on socket %d\n",_fd);
-      exit(1);
-    }
+  uint64_t deadline = now + MAX_RTO;
+  for(unsigned i=0; i<MAX_WINDOW; i++)
+    if (_slots[i].busy && _slots[i].sent+_slots[i].rto < deadline)
+      deadline = _slots[i].sent+_slots[i].rto;
+  timespec tmo;
+  tmo.tv_sec  = deadline > now ? (deadline-now)/1000000000 : 0;
+  tmo.tv_nsec = deadline > now ? (deadline-now)%1000000000 : 0;
+
+  pollfd pfd;
+  pfd.fd = _fd;
+  pfd.events = POLLIN | POLLERR;
+
+  unlock();
+  int pv  = ppoll(&pfd, 1, &tmo, 0);
+  int err = errno;
+  lock();
+
+  if (pv < 0 && err != EINTR) {
+    errno = err;
+    perror("Reg: poll");
+    return Reg::SocketError;
+  }
+
+  if (pv > 0 && _receive() < 0)
+    return Reg::SocketError;
 
-    if (pv==0) {
-      fprintf(stderr,"[Reg: timeout %d]",i+1);
+  now = _now();
+  _expire(now);
+  //  A transaction that failed every retry means the target is gone; the
+  //  rest are not left to time out one by one
+  if (_down) {
+    _down = false;
+    _abort(Reg::Timeout);
+  }
+  return _pump(now);
+}
+
+int Transport::wait(Group* g)
+{
+  while(g ? g->pending : (_inflight || !_queue.empty())) {
+    if (_driving) {
+      pthread_cond_wait(&_cv, &_lock);
       continue;
     }
+    if (_fd < 0) {
+      _abort(Reg::SocketError);
+      break;
+    }
+    _driving = true;
+    int r = _drive();
+    if (r < 0)
+      _abort(r);
+    _driving = false;
+    pthread_cond_broadcast(&_cv);
+  }
 
-    uint32_t rbuff[4];
-    int ret = ::read(_fd, rbuff, sizeof(rbuff));
-#ifdef DBUG
-    printf("Recv %08x %08x %08x %08x [%d]\n",
-	   rbuff[0],rbuff[1],rbuff[2],rbuff[3],ret);
-#endif
+  if (g)
+    return g->failed ? g->status : Reg::Success;
 
-    if (ret      != sizeof(rbuff) ||
-	rbuff[0] != _context ||
-	rbuff[1] != addr) {
-      printf("Error reading [%x,%x]/[%x,%x] %d bytes, retry %d\n",
-	     rbuff[0], rbuff[1], _context, addr, ret, i+1);
+  int r = _status;
+  _status = Reg::Success;
+  return r;
+}
+
+//
+//  Connections
+//
+class RegConnection::Impl {
+public:
+  ~Impl()
+  {
+    for(unsigned i=0; i<transports.size(); i++)
+      delete transports[i];
+    if (perThread)
+      pthread_key_delete(key);
+    pthread_mutex_destroy(&lock);
+  }
+public:
+  //  The calling thread's transport; current() does not create one
+  Transport* transport();
+  Transport* current  () const
+  { return perThread ? reinterpret_cast<Transport*>(pthread_getspecific(key)) : shared; }
+  Transport* create   (int& status);
+public:
+  sockaddr_in             addr;
+  unsigned                mem;
+  char*                   base;
+  unsigned                index;
+  bool                    perThread;
+  int                     status;
+  pthread_mutex_t         lock;       // guards what follows
+  unsigned                window;
+  unsigned                tries;
+  Transport*              shared;
+  pthread_key_t           key;        // per thread Transport
+  std::vector<Transport*> transports;
+  Reg::Stats              retired;    // of threads that exited
+};
+
+static pthread_mutex_t      _tableLock = PTHREAD_MUTEX_INITIALIZER;
+static RegConnection::Impl* _table[MAX_CONNECTIONS];
+static RegConnection*       _default;
+
+//  Failure of the operators for Reg::status(), per thread
+static __thread int         _error = Reg::Success;
+
+Transport* RegConnection::Impl::create(int& status)
+{
+  Transport* t = new Transport(window, tries);
+  t->owner = this;
+  status = t->open(addr);
+  transports.push_back(t);
+  return t;
+}
+
+//  A thread with its own transport exits
+static void _release(void* p)
+{
+  Transport* t = reinterpret_cast<Transport*>(p);
+  RegConnection::Impl* c = reinterpret_cast<RegConnection::Impl*>(t->owner);
+  Reg::Stats s;
+  t->lock();
+  t->wait(0);
+  t->stats(s, false);
+  t->unlock();
+  pthread_mutex_lock(&c->lock);
+  _add(c->retired, s);
+  c->transports.erase(std::find(c->transports.begin(), c->transports.end(), t));
+  pthread_mutex_unlock(&c->lock);
+  delete t;
+}
+
+Transport* RegConnection::Impl::transport()
+{
+  if (!perThread)
+    return shared;
+  Transport* t = reinterpret_cast<Transport*>(pthread_getspecific(key));
+  if (!t) {
+    int s;
+    pthread_mutex_lock(&lock);
+    t = create(s);
+    pthread_mutex_unlock(&lock);
+    pthread_setspecific(key, t);
+  }
+  return t;
+}
+
+static RegConnection::Impl* _connection(const void* reg)
+{
+  uintptr_t i = reinterpret_cast<uintptr_t>(reg) >> SPACE_SHIFT;
+  return i < MAX_CONNECTIONS ? _table[i] : 0;
+}
+
+RegConnection::RegConnection(const char*    host,
+                             unsigned short port,
+                             unsigned       mem,
+                             bool           perThread) :
+  _impl(new Impl)
+{
+  _init(host, port, mem, perThread, -1);
+}
+
+RegConnection::RegConnection(const char*    host,
+                             unsigned short port,
+                             unsigned       mem,
+                             bool           perThread,
+                             int            index) :
+  _impl(new Impl)
+{
+  _init(host, port, mem, perThread, index);
+}
+
+void RegConnection::_init(const char*    host,
+                          unsigned short port,
+                          unsigned       mem,
+                          bool           perThread,
+                          int            index)
+{
+  Impl& c = *_impl;
+  memset(&c.addr, 0, sizeof(c.addr));
+  c.addr.sin_family      = AF_INET;
+  c.addr.sin_addr.s_addr = inet_addr(host);
+  c.addr.sin_port        = htons(port);
+  c.mem       = mem;
+  c.perThread = perThread;
+  c.status    = Reg::Success;
+  c.window    = 32;
+  c.tries     = 10;
+  c.shared    = 0;
+  pthread_mutex_init(&c.lock, 0);
+  _clear(c.retired);
+  if (perThread)
+    pthread_key_create(&c.key, _release);
+
+  pthread_mutex_lock(&_tableLock);
+  if (index < 0) {
+    index = 1;
+    while(index < int(MAX_CONNECTIONS) && _table[index])
+      index++;
+  }
+  if (index < int(MAX_CONNECTIONS) && !_table[index]) {
+    c.index = index;
+    c.base  = reinterpret_cast<char*>(uintptr_t(index) << SPACE_SHIFT);
+  }
+  else {
+    fprintf(stderr,"RegConnection: no address space left for %s\n",host);
+    c.index  = MAX_CONNECTIONS;
+    c.base   = 0;
+    c.status = Reg::SocketError;
+  }
+  pthread_mutex_unlock(&_tableLock);
+
+  if (c.status < 0)
+    return;
+
+  if (perThread) {
+    //  Check the target address now rather than on first use
+    Transport t(c.window, c.tries);
+    c.status = t.open(c.addr);
+  }
+  else
+    c.shared = c.create(c.status);
+
+  pthread_mutex_lock(&_tableLock);
+  _table[c.index] = _impl;
+  pthread_mutex_unlock(&_tableLock);
+}
+
+RegConnection::~RegConnection()
+{
+  pthread_mutex_lock(&_tableLock);
+  if (_impl->index < MAX_CONNECTIONS && _table[_impl->index]==_impl)
+    _table[_impl->index] = 0;
+  pthread_mutex_unlock(&_tableLock);
+  delete _impl;
+}
+
+int RegConnection::status() const
+{
+  return _impl->status;
+}
+
+char* RegConnection::base() const
+{
+  return _impl->base;
+}
+
+void RegConnection::window(unsigned n)
+{
+  n = n < 1 ? 1 : n > MAX_WINDOW ? MAX_WINDOW : n;
+  pthread_mutex_lock(&_impl->lock);
+  _impl->window = n;
+  for(unsigned i=0; i<_impl->transports.size(); i++) {
+    Transport* t = _impl->transports[i];
+    t->lock();
+    t->window = n;
+    t->unlock();
+  }
+  pthread_mutex_unlock(&_impl->lock);
+}
+
+void RegConnection::retries(unsigned n)
+{
+  pthread_mutex_lock(&_impl->lock);
+  _impl->tries = n+1;
+  for(unsigned i=0; i<_impl->transports.size(); i++) {
+    Transport* t = _impl->transports[i];
+    t->lock();
+    t->tries = n+1;
+    t->unlock();
+  }
+  pthread_mutex_unlock(&_impl->lock);
+}
+
+void RegConnection::stats(Reg::Stats& s, bool reset)
+{
+  Reg::Stats own;
+  _clear(own);
+  Transport* mine = _impl->current();
+
+  pthread_mutex_lock(&_impl->lock);
+  s = _impl->retired;
+  if (reset)
+    _clear(_impl->retired);
+  for(unsigned i=0; i<_impl->transports.size(); i++) {
+    Transport* t = _impl->transports[i];
+    Reg::Stats ts;
+    t->lock();
+    t->stats(ts, reset);
+    t->unlock();
+    _add(s, ts);
+    if (t == mine)
+      own = ts;
+  }
+  pthread_mutex_unlock(&_impl->lock);
+
+  s.srttNs   = own.srttNs;
+  s.rttvarNs = own.rttvarNs;
+  s.rtoNs    = own.rtoNs;
+}
+
+int RegConnection::flush()
+{
+  if (_impl->status < 0)
+    return _impl->status;
+  Transport* t = _impl->transport();
+  t->lock();
+  int r = t->wait(0);
+  t->unlock();
+  return r;
+}
+
+//
+//  Registers
+//
+using namespace Pds::Cphw;
+
+void Reg::setBit  (unsigned b)
+{
+  unsigned r = *this;
+  *this = r | (1<<b);
+}
+
+void Reg::clearBit(unsigned b)
+{
+  unsigned r = *this;
+  *this = r &~(1<<b);
+}
+
+int Reg::set(const char* host,
+             unsigned short port,
+             unsigned mem,
+             unsigned long long memsz)
+{
+  delete _default;
+  _default = new RegConnection(host, port, mem, false, 0);
+  return _default->status();
+}
+
+void Reg::window(unsigned n)
+{
+  if (_default)
+    _default->window(n);
+}
+
+void Reg::retries(unsigned n)
+{
+  if (_default)
+    _default->retries(n);
+}
+
+void Reg::stats(Stats& s, bool reset)
+{
+  if (_default)
+    _default->stats(s, reset);
+  else
+    _clear(s);
+}
+
+int Reg::status()
+{
+  int r = _error;
+  _error = Success;
+  return r;
+}
+
+int Reg::flush()
+{
+  int r = Success;
+  for(unsigned i=0; i<MAX_CONNECTIONS; i++) {
+    RegConnection::Impl* c = _table[i];
+    Transport* t = c ? c->current() : 0;
+    if (!t)
       continue;
+    t->lock();
+    int s = t->wait(0);
+    t->unlock();
+    if (s < r)
+      r = s;
+  }
+  return r;
+}
+
+static Request _request(uint32_t addr, unsigned n, uint32_t value,
+                        const uint32_t* src, uint32_t* dst, Group* group)
+{
+  Request r;
+  r.addr   = addr;
+  r.n      = n;
+  r.value  = value;
+  r.src    = src;
+  r.dst    = dst;
+  r.group  = group;
+  return r;
+}
+
+//  The calling thread's transport to the register's target, locked;
+//  0 if there is no open connection at that address
+static Transport* _transport(const Reg* reg, uint32_t& addr)
+{
+  RegConnection::Impl* c = _connection(reg);
+  if (!c || c->status < 0)
+    return 0;
+  addr = ((c->mem + uint64_t(reinterpret_cast<const char*>(reg) - c->base))>>2)&0x3fffffff;
+  Transport* t = c->transport();
+  t->lock();
+  return t;
+}
+
+//  Split into requests of at most MAX_WORDS
+static void _block(Transport* t, uint32_t addr, unsigned n,
+                   const uint32_t* src, uint32_t* dst, Group* group)
+{
+  for(unsigned i=0; i<n; i+=MAX_WORDS) {
+    unsigned m = n-i < MAX_WORDS ? n-i : MAX_WORDS;
+    t->post(_request(addr+i, m, 0,
+                     src ? src+i : 0,
+                     dst ? dst+i : 0, group));
+  }
+}
+
+void Reg::post(unsigned v)
+{
+  uint32_t addr;
+  Transport* t = _transport(this, addr);
+  if (!t) {
+    _error = SocketError;
+    return;
+  }
+  t->post(_request(addr | WRITE, 1, v, 0, 0, 0));
+  t->unlock();
+}
+
+void Reg::fetch(uint32_t& v) const
+{
+  uint32_t addr;
+  Transport* t = _transport(this, addr);
+  if (!t) {
+    _error = SocketError;
+    return;
+  }
+  t->post(_request(addr, 1, 0, 0, &v, 0));
+  t->unlock();
+}
+
+int Reg::read(uint32_t* v, unsigned n) const
+{
+  uint32_t addr;
+  Transport* t = _transport(this, addr);
+  if (!t)
+    return SocketError;
+  Group g;
+  _block(t, addr, n, 0, v, &g);
+  int r = t->wait(&g);
+  t->unlock();
+  return r;
+}
+
+int Reg::write(const uint32_t* v, unsigned n)
+{
+  uint32_t addr;
+  Transport* t = _transport(this, addr);
+  if (!t)
+    return SocketError;
+  Group g;
+  _block(t, addr | WRITE, n, v, 0, &g);
+  int r = t->wait(&g);
+  t->unlock();
+  return r;
+}
+
+//  Runs of consecutive registers become one request each
+static int _gather(const Reg* const* regs, const uint32_t* src,
+                   uint32_t* dst, unsigned n)
+{
+  std::vector<Transport*> ts;
+  std::deque <Group>      gs;
+  int r = Reg::Success;
+  for(unsigned i=0; i<n; ) {
+    unsigned j=i+1;
+    while(j<n && regs[j]==regs[j-1]+1)
+      j++;
+    uint32_t addr;
+    Transport* t = _transport(regs[i], addr);
+    if (!t)
+      r = Reg::SocketError;
+    else {
+      unsigned k = std::find(ts.begin(), ts.end(), t) - ts.begin();
+      if (k == ts.size()) {
+        ts.push_back(t);
+        gs.push_back(Group());
+      }
+      _block(t, addr | (src ? WRITE : 0), j-i,
+             src ? src+i : 0, dst ? dst+i : 0, &gs[k]);
+      t->unlock();
     }
-  
-    sem_post(&_sem);
-    return rbuff[2];
+    i = j;
+  }
+  for(unsigned k=0; k<ts.size(); k++) {
+    ts[k]->lock();
+    int s = ts[k]->wait(&gs[k]);
+    ts[k]->unlock();
+    if (s < r)
+      r = s;
+  }
+  return r;
+}
+
+int Reg::read(const Reg* const* regs, uint32_t* v, unsigned n)
+{
+  return _gather(regs, 0, v, n);
+}
+
+int Reg::write(Reg* const* regs, const uint32_t* v, unsigned n)
+{
+  return _gather(regs, v, 0, n);
+}
+
+Reg& Reg::operator=(const unsigned v)
+{
+  uint32_t addr;
+  Transport* t = _transport(this, addr);
+  if (!t) {
+    _error = SocketError;
+    return *this;
   }
+  Group g;
+  t->post(_request(addr | WRITE, 1, v, 0, 0, &g));
+  int s = t->wait(&g);
+  t->unlock();
+  if (s < 0)
+    _error = s;
+  return *this;
+}
 
-  printf("Reg[%p]::operator unsigned() FAILED\n",this);
-  sem_post(&_sem);
-  return 0;
+Reg::operator unsigned() const
+{
+  uint32_t addr;
+  Transport* t = _transport(this, addr);
+  if (!t) {
+    _error = SocketError;
+    return 0;
+  }
+  uint32_t v = 0;
+  Group g;
+  t->post(_request(addr, 1, 0, 0, &v, &g));
+  int s = t->wait(&g);
+  t->unlock();
+  if (s < 0)
+    _error = s;
+  return s < 0 ? 0 : v;
 }
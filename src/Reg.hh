@@ -12,23 +12,107 @@
 
 #include <stdint.h>
 
+#include <new>
+
 namespace Pds {
   namespace Cphw {
     class Reg {
     public:
+      enum Status { Success=0, Timeout=-1, SocketError=-2 };
+      //  Transport counters; rtt/rto are the current estimates
+      class Stats {
+      public:
+        uint64_t requests;    // transactions posted
+        uint64_t datagrams;   // sent, including retries
+        uint64_t retries;
+        uint64_t timeouts;    // transactions given up
+        uint64_t late;        // responses after the transaction was given up
+        uint64_t duplicates;  // responses to a retry of a completed transaction
+        uint64_t errors;      // malformed or mismatched responses
+        uint64_t srttNs;
+        uint64_t rttvarNs;
+        uint64_t rtoNs;
+      };
+    public:
+      //  On failure a read returns 0; see status()
       Reg& operator=(const unsigned);
       operator unsigned() const;
     public:
       void setBit  (unsigned);
       void clearBit(unsigned);
     public:
-      static void set(const char* ip,
+      //  Pipelined access: queued requests are kept up to the window in
+      //  flight and complete, in any order, by the next flush()
+      void post (unsigned v);
+      void fetch(uint32_t& v) const;
+      //  Completes this thread's queued accesses on every connection;
+      //  returns a Status
+      static int  flush ();
+      //  Of the connection opened by set():
+      //  requests in flight (1..256, default 32)
+      static void window (unsigned n);
+      //  resends of a transaction before it fails (default 9)
+      static void retries(unsigned n);
+    public:
+      //  Block access to n consecutive registers from this one, in as few
+      //  datagrams as fit the MTU.  Return a Status.
+      int  read (uint32_t* v, unsigned n) const;
+      int  write(const uint32_t* v, unsigned n);
+      //  Scatter/gather; runs of consecutive registers share a datagram
+      static int read (const Reg* const* regs, uint32_t* v, unsigned n);
+      static int write(Reg* const* regs, const uint32_t* v, unsigned n);
+      //  Whole-struct snapshot of a block of registers (and reserved words)
+      template <class T>
+      static int snapshot(const T& t, uint32_t* v)
+      { return reinterpret_cast<const Reg&>(t).read(v, sizeof(T)/sizeof(uint32_t)); }
+    public:
+      //  Connects registers placed from address 0, as a RegConnection
+      static int  set(const char* ip,
                       unsigned short port,
                       unsigned mem, 
                       unsigned long long memsz=(1ULL<<32));
+      //  Failure of the operators since last called
+      static int  status();
+      static void stats (Stats&, bool reset=false);
     private:
       uint32_t _reserved;
     };
+
+    //
+    //  A register target.  Each connection has its own range of addresses
+    //  from base(); register structs placed there (map()) access it.
+    //  Threads share one socket and window, or with perThread each thread
+    //  gets a socket of its own and no lock is shared between threads.
+    //
+    class RegConnection {
+    public:
+      RegConnection(const char* ip,
+                    unsigned short port,
+                    unsigned mem=0,
+                    bool perThread=false);
+      ~RegConnection();
+    public:
+      int   status () const;    // SocketError if it could not be opened
+      char* base   () const;
+      template <class T>
+      T*    map    (uint32_t offset) const { return new (base()+offset) T; }
+    public:
+      int   flush  ();
+      void  window (unsigned n);
+      void  retries(unsigned n);
+      //  Counters summed over threads; rtt/rto of the calling thread
+      void  stats  (Reg::Stats&, bool reset=false);
+    public:
+      class Impl;
+    private:
+      friend class Reg;
+      RegConnection(const char*, unsigned short, unsigned, bool, int index);
+      void  _init  (const char*, unsigned short, unsigned, bool, int index);
+      RegConnection(const RegConnection&);
+      RegConnection& operator=(const RegConnection&);
+    private:
+      Impl* _impl;
+    };
   };
 };
 
@@ -0,0 +1,401 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "RegEmulator.hh"
+
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+
+#include <vector>
+
+static const uint32_t WRITE     = 0x40000000;
+static const uint32_t ADDR_MASK = 0x3fffffff;
+static const unsigned MAX_WORDS = 2048;
+
+using namespace Pds::Cphw;
+
+class RegEmulator::Response {
+public:
+  sockaddr_in           addr;
+  std::vector<uint32_t> buff;
+};
+
+static uint64_t _now()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return uint64_t(ts.tv_sec)*1000000000ULL + ts.tv_nsec;
+}
+
+RegEmulator::RegEmulator(unsigned short port, const char* ip) :
+  _fd     (-1),
+  _port   (0),
+  _lossReq(0),
+  _lossRsp(0),
+  _dup    (0),
+  _minUs  (0),
+  _maxUs  (0),
+  _seed   (1),
+  _running(false),
+  _threaded(false)
+{
+  pthread_mutex_init(&_lock, 0);
+  memset(&_stats, 0, sizeof(_stats));
+
+  _fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+  if (_fd < 0) {
+    perror("RegEmulator: socket");
+    return;
+  }
+
+  sockaddr_in saddr;
+  memset(&saddr, 0, sizeof(saddr));
+  saddr.sin_family      = AF_INET;
+  saddr.sin_addr.s_addr = inet_addr(ip);
+  saddr.sin_port        = htons(port);
+  socklen_t len = sizeof(saddr);
+  if (::bind(_fd, reinterpret_cast<const sockaddr*>(&saddr), len) < 0 ||
+      ::getsockname(_fd, reinterpret_cast<sockaddr*>(&saddr), &len) < 0) {
+    perror("RegEmulator: bind");
+    ::close(_fd);
+    _fd = -1;
+    return;
+  }
+  _port = ntohs(saddr.sin_port);
+}
+
+RegEmulator::~RegEmulator()
+{
+  stop();
+  for(std::multimap<uint64_t,Response*>::iterator it=_delayed.begin(); it!=_delayed.end(); it++)
+    delete it->second;
+  if (_fd >= 0)
+    ::close(_fd);
+  pthread_mutex_destroy(&_lock);
+}
+
+void RegEmulator::poke(uint32_t addr, uint32_t v)
+{
+  pthread_mutex_lock(&_lock);
+  _regs[(addr>>2)&ADDR_MASK].value = v;
+  pthread_mutex_unlock(&_lock);
+}
+
+uint32_t RegEmulator::peek(uint32_t addr) const
+{
+  pthread_mutex_lock(&_lock);
+  std::map<uint32_t,Register>::const_iterator it = _regs.find((addr>>2)&ADDR_MASK);
+  uint32_t v = it==_regs.end() ? 0 : it->second.value;
+  pthread_mutex_unlock(&_lock);
+  return v;
+}
+
+void RegEmulator::behave(uint32_t addr, Behaviour b, uint32_t arg)
+{
+  pthread_mutex_lock(&_lock);
+  Register& r = _regs[(addr>>2)&ADDR_MASK];
+  r.behaviour = b;
+  r.arg       = arg;
+  pthread_mutex_unlock(&_lock);
+}
+
+int RegEmulator::load(const char* fname)
+{
+  FILE* f = fopen(fname,"r");
+  if (!f) {
+    perror(fname);
+    return -1;
+  }
+
+  int  n = 0;
+  unsigned line = 0;
+  char buff[256];
+  while(fgets(buff, sizeof(buff), f)) {
+    line++;
+    char* p = strchr(buff,'#');
+    if (p) *p = 0;
+
+    char     kind[32];
+    unsigned addr, value, arg = 0;
+    int args = sscanf(buff,"%i %i %31s %i",&addr,&value,kind,&arg);
+    if (args <= 0)
+      continue;
+    if (args < 2) {
+      fprintf(stderr,"%s:%u: expected address and value\n",fname,line);
+      fclose(f);
+      return -1;
+    }
+
+    poke(addr, value);
+    if (args >= 3) {
+      if      (strcmp(kind,"counter")==0) behave(addr, Counter  , args>3 ? arg : 1);
+      else if (strcmp(kind,"clear"  )==0) behave(addr, ReadClear, arg);
+      else if (strcmp(kind,"strobe" )==0) behave(addr, Strobe   , arg);
+      else if (strcmp(kind,"ro"     )==0) behave(addr, ReadOnly , 0);
+      else {
+        fprintf(stderr,"%s:%u: unknown behaviour %s\n",fname,line,kind);
+        fclose(f);
+        return -1;
+      }
+    }
+    n++;
+  }
+  fclose(f);
+  return n;
+}
+
+void RegEmulator::loss(double request, double response)
+{
+  _lossReq = request;
+  _lossRsp = response;
+}
+
+void RegEmulator::latency(unsigned minUs, unsigned maxUs)
+{
+  _minUs = minUs;
+  _maxUs = maxUs < minUs ? minUs : maxUs;
+}
+
+void RegEmulator::duplicate(double p)
+{
+  _dup = p;
+}
+
+void RegEmulator::seed(unsigned s)
+{
+  _seed = s;
+}
+
+bool RegEmulator::_chance(double p)
+{
+  return p > 0 && rand_r(&_seed) < p*(double(RAND_MAX)+1.);
+}
+
+uint32_t RegEmulator::_read(uint32_t word)
+{
+  std::map<uint32_t,Register>::iterator it = _regs.find(word);
+  if (it == _regs.end())
+    return 0;
+  Register& r = it->second;
+  uint32_t v = r.value;
+  switch(r.behaviour) {
+  case Counter  : r.value += r.arg; break;
+  case ReadClear: r.value &= r.arg ? ~r.arg : 0; break;
+  default: break;
+  }
+  return v;
+}
+
+void RegEmulator::_write(uint32_t word, uint32_t v)
+{
+  Register& r = _regs[word];
+  switch(r.behaviour) {
+  case ReadOnly: break;
+  case Strobe  : r.value = v & ~r.arg; break;
+  default      : r.value = v; break;
+  }
+}
+
+void RegEmulator::_send(const Response& r)
+{
+  ::sendto(_fd, r.buff.data(), r.buff.size()*sizeof(uint32_t), 0,
+           reinterpret_cast<const sockaddr*>(&r.addr), sizeof(r.addr));
+}
+
+//  Requests are [context, addr|op, data.., 0] for writes and
+//  [context, addr, nwords-1, 0] for reads
+void RegEmulator::_handle(const uint32_t* req, int len,
+                          const void* from, unsigned fromlen, uint64_t now)
+{
+  _stats.requests++;
+  if (len < 16 || len%4) {
+    _stats.errors++;
+    return;
+  }
+  unsigned nw = len/4;
+  if (_chance(_lossReq)) {
+    _stats.dropped++;
+    return;
+  }
+
+  uint32_t word = req[1] & ADDR_MASK;
+  unsigned n    = (req[1] & WRITE) ? nw-3 : req[2]+1;
+  if (n > MAX_WORDS) {
+    _stats.errors++;
+    return;
+  }
+
+  Response* r = new Response;
+  memcpy(&r->addr, from, fromlen < sizeof(r->addr) ? fromlen : sizeof(r->addr));
+  r->buff.resize(n+3);
+  r->buff[0] = req[0];
+  r->buff[1] = req[1];
+  if (req[1] & WRITE) {
+    for(unsigned i=0; i<n; i++) {
+      _write(word+i, req[i+2]);
+      r->buff[i+2] = req[i+2];
+    }
+    _stats.writes += n;
+  }
+  else {
+    for(unsigned i=0; i<n; i++)
+      r->buff[i+2] = _read(word+i);
+    _stats.reads += n;
+  }
+  r->buff[n+2] = 0;
+
+  if (_chance(_lossRsp)) {
+    _stats.dropped++;
+    delete r;
+    return;
+  }
+
+  unsigned copies = _chance(_dup) ? 2 : 1;
+  if (copies > 1)
+    _stats.duplicated++;
+
+  for(unsigned i=copies; i-- > 0; ) {
+    Response* c = i ? new Response(*r) : r;
+    if (_maxUs) {
+      uint64_t us = _minUs + (_maxUs > _minUs ? rand_r(&_seed)%(_maxUs-_minUs+1) : 0);
+      _delayed.insert(std::make_pair(now+us*1000, c));
+      _stats.delayed++;
+    }
+    else {
+      _send(*c);
+      delete c;
+    }
+  }
+}
+
+void RegEmulator::serve(int timeoutMs)
+{
+  _running = true;
+  _serve(timeoutMs);
+}
+
+//  start() sets _running before the thread exists, so a stop() racing
+//  with the thread's startup is never undone here
+void RegEmulator::_serve(int timeoutMs)
+{
+  if (_fd < 0)
+    return;
+
+  uint64_t idle = timeoutMs < 0 ? 0 : _now() + uint64_t(timeoutMs)*1000000;
+  uint32_t buff[MAX_WORDS+3];
+  while(_running) {
+    uint64_t now = _now();
+
+    pthread_mutex_lock(&_lock);
+    while(!_delayed.empty() && _delayed.begin()->first <= now) {
+      _send(*_delayed.begin()->second);
+      delete _delayed.begin()->second;
+      _delayed.erase(_delayed.begin());
+    }
+    //  Wake for the next delayed response, and to check _running
+    uint64_t wake = now + 100000000;
+    if (!_delayed.empty() && _delayed.begin()->first < wake)
+      wake = _delayed.begin()->first;
+    pthread_mutex_unlock(&_lock);
+
+    if (idle && now >= idle && _delayed.empty())
+      break;
+
+    timespec tmo;
+    tmo.tv_sec  = (wake-now)/1000000000;
+    tmo.tv_nsec = (wake-now)%1000000000;
+
+    pollfd pfd;
+    pfd.fd     = _fd;
+    pfd.events = POLLIN;
+    if (ppoll(&pfd, 1, &tmo, 0) <= 0)
+      continue;
+
+    sockaddr_in from;
+    socklen_t   fromlen = sizeof(from);
+    int len;
+    while((len = ::recvfrom(_fd, buff, sizeof(buff), MSG_DONTWAIT,
+                            reinterpret_cast<sockaddr*>(&from), &fromlen)) >= 0) {
+      now = _now();
+      pthread_mutex_lock(&_lock);
+      _handle(buff, len, &from, fromlen, now);
+      pthread_mutex_unlock(&_lock);
+      if (timeoutMs >= 0)
+        idle = now + uint64_t(timeoutMs)*1000000;
+      fromlen = sizeof(from);
+    }
+  }
+  _running = false;
+}
+
+void* RegEmulator::_run(void* p)
+{
+  reinterpret_cast<RegEmulator*>(p)->_serve(-1);
+  return 0;
+}
+
+int RegEmulator::start()
+{
+  if (_fd < 0)
+    return -1;
+  _running = true;
+  if (pthread_create(&_thread, 0, _run, this)) {
+    _running = false;
+    return -1;
+  }
+  _threaded = true;
+  return 0;
+}
+
+void RegEmulator::stop()
+{
+  _running = false;
+  if (_threaded) {
+    pthread_join(_thread, 0);
+    _threaded = false;
+  }
+}
+
+void RegEmulator::stats(Stats& s) const
+{
+  pthread_mutex_lock(&_lock);
+  s = _stats;
+  pthread_mutex_unlock(&_lock);
+}
+
+void RegEmulator::dump(FILE* f) const
+{
+  static const char* names[] = { "", "counter", "clear", "strobe", "ro" };
+  pthread_mutex_lock(&_lock);
+  //  In the format of load(), the statistics as a comment
+  fprintf(f,"# %llu requests, %llu words read, %llu written, %llu dropped, "
+          "%llu delayed, %llu duplicated, %llu errors\n",
+          (unsigned long long)_stats.requests,
+          (unsigned long long)_stats.reads,
+          (unsigned long long)_stats.writes,
+          (unsigned long long)_stats.dropped,
+          (unsigned long long)_stats.delayed,
+          (unsigned long long)_stats.duplicated,
+          (unsigned long long)_stats.errors);
+  for(std::map<uint32_t,Register>::const_iterator it=_regs.begin(); it!=_regs.end(); it++) {
+    const Register& r = it->second;
+    fprintf(f,"0x%08x 0x%08x", it->first<<2, r.value);
+    if (r.behaviour != Plain)
+      fprintf(f," %s", names[r.behaviour]);
+    if (r.behaviour != Plain && r.behaviour != ReadOnly)
+      fprintf(f," 0x%x", r.arg);
+    fprintf(f,"\n");
+  }
+  pthread_mutex_unlock(&_lock);
+}
@@ -0,0 +1,122 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef Cphw_RegEmulator_hh
+#define Cphw_RegEmulator_hh
+
+//
+//  Register target emulator for the Reg protocol (Reg.cc), for running
+//  the register tools and benchmarking the client without the FPGA.
+//
+//  Registers live in a sparse map; unwritten registers read as zero.  A
+//  register may be given a behaviour:
+//
+//    Counter    each read returns the value, then adds arg
+//    ReadClear  each read clears the bits in arg (all if 0)
+//    Strobe     bits in arg are self-clearing: a write acts on them but
+//               they read back as zero (e.g. MpsSim csr bit 31)
+//    ReadOnly   writes are acknowledged and ignored
+//
+//  Requests and responses can be dropped, responses delayed by a random
+//  latency (which reorders them) and duplicated.
+//
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#include <map>
+
+namespace Pds {
+  namespace Cphw {
+    class RegEmulator {
+    public:
+      enum Behaviour { Plain, Counter, ReadClear, Strobe, ReadOnly };
+      class Stats {
+      public:
+        uint64_t requests;
+        uint64_t reads;      // words
+        uint64_t writes;     // words
+        uint64_t dropped;    // requests and responses
+        uint64_t delayed;
+        uint64_t duplicated;
+        uint64_t errors;     // malformed requests
+      };
+    public:
+      //  port 0 binds an ephemeral port; see port()
+      RegEmulator(unsigned short port, const char* ip="127.0.0.1");
+      ~RegEmulator();
+    public:
+      int            status() const { return _fd < 0 ? -1 : 0; }
+      unsigned short port  () const { return _port; }
+    public:
+      //  Byte addresses, as placed by the client
+      void     poke  (uint32_t addr, uint32_t v);
+      uint32_t peek  (uint32_t addr) const;
+      void     behave(uint32_t addr, Behaviour, uint32_t arg=0);
+      //  Lines of "addr value [counter n|clear mask|strobe mask|ro]";
+      //  returns the number of registers or <0
+      int      load  (const char* fname);
+    public:
+      //  Probabilities of dropping a request or a response
+      void     loss     (double request, double response);
+      //  Responses delayed uniformly in [minUs,maxUs]
+      void     latency  (unsigned minUs, unsigned maxUs);
+      void     duplicate(double p);
+      void     seed     (unsigned);
+    public:
+      //  Serve from a thread of its own, or from the caller; stop() ends
+      //  either (and may be called from a signal handler for the latter)
+      int      start ();
+      void     stop  ();
+      //  Serves until timeoutMs passes without a request (or <0: forever)
+      void     serve (int timeoutMs);
+      void     stats (Stats&) const;
+      void     dump  (FILE*) const;
+    private:
+      class Register {
+      public:
+        Register() : value(0), behaviour(Plain), arg(0) {}
+      public:
+        uint32_t  value;
+        Behaviour behaviour;
+        uint32_t  arg;
+      };
+      class Response;
+      void     _handle (const uint32_t* req, int len,
+                        const void* from, unsigned fromlen, uint64_t now);
+      uint32_t _read   (uint32_t word);
+      void     _write  (uint32_t word, uint32_t v);
+      void     _serve  (int timeoutMs);
+      void     _send   (const Response&);
+      bool     _chance (double p);
+      static void* _run(void*);
+    private:
+      RegEmulator(const RegEmulator&);
+      RegEmulator& operator=(const RegEmulator&);
+    private:
+      int                               _fd;
+      unsigned short                    _port;
+      mutable pthread_mutex_t           _lock;
+      std::map<uint32_t,Register>       _regs;     // by word address
+      std::multimap<uint64_t,Response*> _delayed;  // by due time [ns]
+      double                            _lossReq;
+      double                            _lossRsp;
+      double                            _dup;
+      unsigned                          _minUs;
+      unsigned                          _maxUs;
+      unsigned                          _seed;
+      Stats                             _stats;
+      pthread_t                         _thread;
+      volatile bool                     _running;
+      bool                              _threaded;
+    };
+  };
+};
+
+#endif
@@ -0,0 +1,307 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "bsa_engine.hh"
+#include "tpr_segments.hh"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <new>
+
+//  Same limits as TPGYaml::startBSA
+static const unsigned MAXACQBSA  = (1<<16)-1;
+static const unsigned MAXAVGBSA  = (1<<13)-1;
+
+//  Arrays are padded and aligned to four doubles.  The vector type is the
+//  target's own width: a 32 byte vector without AVX is split through the
+//  stack and runs at a third of the speed of SSE2 pairs.
+#ifdef __AVX__
+typedef double vd __attribute__((vector_size(32)));
+#else
+typedef double vd __attribute__((vector_size(16)));
+#endif
+static const unsigned VLEN   = 4;
+static const unsigned VALIGN = 32;
+static const unsigned VW     = sizeof(vd)/sizeof(double);
+
+using namespace Tpr;
+
+static double* _alloc(unsigned n)
+{
+  void* p = 0;
+  if (posix_memalign(&p, VALIGN, n*sizeof(double)))
+    throw std::bad_alloc();
+  memset(p, 0, n*sizeof(double));
+  return static_cast<double*>(p);
+}
+
+//  s[i] += x[i], s2[i] += x2[i]; n a multiple of VLEN, arrays aligned
+static inline void _add(double* __restrict s , const double* __restrict x ,
+                        double* __restrict s2, const double* __restrict x2,
+                        unsigned n)
+{
+  vd*       vs  = reinterpret_cast<vd*>(s);
+  vd*       vs2 = reinterpret_cast<vd*>(s2);
+  const vd* vx  = reinterpret_cast<const vd*>(x);
+  const vd* vx2 = reinterpret_cast<const vd*>(x2);
+  for(unsigned i=0; i<n/VW; i++) {
+    vs [i] += vx [i];
+    vs2[i] += vx2[i];
+  }
+}
+
+class BsaEngine::Edef {
+public:
+  Edef() : sum(0), sumsq(0), n(0),
+           nToAverage(0), avgToAcquire(0), capacity(0),
+           rows(0), head(0), done(true) {}
+  ~Edef() { free(sum); free(sumsq); }
+public:
+  void reset(unsigned stride)
+  {
+    memset(sum  , 0, stride*sizeof(double));
+    memset(sumsq, 0, stride*sizeof(double));
+    n    = 0;
+    rows = 0;
+    head = 0;
+    done = false;
+    meanv.clear();
+    rmsv .clear();
+    pid  .clear();
+    ts   .clear();
+    ns   .clear();
+  }
+public:
+  double*  sum;
+  double*  sumsq;
+  unsigned n;             // samples in the open average
+  unsigned nToAverage;
+  unsigned avgToAcquire;  // 0 = continuous
+  unsigned capacity;      // result rows kept
+  unsigned rows;          // result rows stored
+  unsigned head;          // oldest row once full
+  bool     done;
+  std::vector<double>   meanv;  // [row][stride]
+  std::vector<double>   rmsv;
+  std::vector<uint64_t> pid;
+  std::vector<uint64_t> ts;
+  std::vector<unsigned> ns;
+};
+
+BsaEngine::BsaEngine(unsigned nchannels) :
+  _nch     (nchannels),
+  _stride  ((nchannels+VLEN-1)/VLEN*VLEN),
+  _x       (_alloc(_stride)),
+  _x2      (_alloc(_stride)),
+  _edef    (new Edef[NEDEFS]),
+  _enabled (0),
+  _doneMask(0)
+{
+  for(unsigned i=0; i<NEDEFS; i++) {
+    _edef[i].sum   = _alloc(_stride);
+    _edef[i].sumsq = _alloc(_stride);
+  }
+}
+
+BsaEngine::~BsaEngine()
+{
+  delete[] _edef;
+  free(_x);
+  free(_x2);
+}
+
+int BsaEngine::start(unsigned edef, unsigned nToAverage, unsigned avgToAcquire)
+{
+  if (edef >= NEDEFS)
+    return -1;
+  if (nToAverage > MAXAVGBSA)
+    return -2;
+  if (avgToAcquire > MAXACQBSA)
+    return -3;
+
+  Edef& e = _edef[edef];
+  e.reset(_stride);
+  e.nToAverage   = nToAverage;
+  e.avgToAcquire = avgToAcquire;
+  e.capacity     = avgToAcquire ? avgToAcquire : unsigned(CONTINUOUS_ROWS);
+
+  //  Reserve up front so results don't reallocate at full rate
+  unsigned nr = e.capacity < unsigned(CONTINUOUS_ROWS) ? e.capacity : unsigned(CONTINUOUS_ROWS);
+  e.meanv.reserve(nr*_stride);
+  e.rmsv .reserve(nr*_stride);
+  e.pid  .reserve(nr);
+  e.ts   .reserve(nr);
+  e.ns   .reserve(nr);
+
+  _enabled  |=  (1ULL<<edef);
+  _doneMask &= ~(1ULL<<edef);
+  return 0;
+}
+
+void BsaEngine::stop(unsigned edef)
+{
+  if (edef < NEDEFS) {
+    _enabled &= ~(1ULL<<edef);
+    _edef[edef].done = true;
+  }
+}
+
+void BsaEngine::control(const BsaControl& c)
+{
+  uint64_t init = c.init & _enabled;
+  while(init) {
+    unsigned i = __builtin_ctzll(init);
+    init &= init-1;
+    _edef[i].reset(_stride);
+    _doneMask &= ~(1ULL<<i);
+  }
+}
+
+void BsaEngine::channel(const BsaChannel& c, const float* values)
+{
+  uint64_t active = c.newActive  & _enabled;
+  uint64_t avgd   = c.newAvgDone & _enabled;
+  uint64_t done   = c.newDone    & _enabled;
+
+  if (active) {
+    //  Stage the values and squares once for all EDEFs
+    for(unsigned i=0; i<_nch; i++) {
+      double v = values[i];
+      _x [i] = v;
+      _x2[i] = v*v;
+    }
+
+    while(active) {
+      unsigned i = __builtin_ctzll(active);
+      active &= active-1;
+      Edef& e = _edef[i];
+      if (e.done)
+        continue;
+      _add(e.sum, _x, e.sumsq, _x2, _stride);
+      if (++e.n == e.nToAverage)
+        avgd |= 1ULL<<i;
+    }
+  }
+
+  while(avgd) {
+    unsigned i = __builtin_ctzll(avgd);
+    avgd &= avgd-1;
+    Edef& e = _edef[i];
+    if (!e.done && e.n)
+      _close(e, c);
+    if (e.done)
+      _doneMask |= 1ULL<<i;
+  }
+
+  while(done) {
+    unsigned i = __builtin_ctzll(done);
+    done &= done-1;
+    _edef[i].done = true;
+    _doneMask |= 1ULL<<i;
+  }
+}
+
+void BsaEngine::process(const Segment& s, const float* values)
+{
+  if (const BsaControl* c = s.bsaControl())
+    control(*c);
+  else if (const BsaChannel* c = s.bsaChannel())
+    channel(*c, values);
+}
+
+void BsaEngine::_close(Edef& e, const BsaChannel& c)
+{
+  unsigned row;
+  if (e.rows < e.capacity) {
+    row = e.rows++;
+    e.meanv.resize(e.rows*_stride);
+    e.rmsv .resize(e.rows*_stride);
+    e.pid  .push_back(0);
+    e.ts   .push_back(0);
+    e.ns   .push_back(0);
+  }
+  else {
+    //  Continuous: overwrite the oldest
+    row = e.head;
+    e.head = (e.head+1)%e.capacity;
+  }
+
+  double  rn = 1./double(e.n);
+  double* m  = &e.meanv[row*_stride];
+  double* r  = &e.rmsv [row*_stride];
+  for(unsigned i=0; i<_nch; i++) {
+    double mu  = e.sum[i]*rn;
+    double var = e.sumsq[i]*rn - mu*mu;
+    m[i] = mu;
+    r[i] = var > 0 ? sqrt(var) : 0;
+  }
+  e.pid[row] = c.pulseId;
+  e.ts [row] = c.timeStamp;
+  e.ns [row] = e.n;
+
+  memset(e.sum  , 0, _stride*sizeof(double));
+  memset(e.sumsq, 0, _stride*sizeof(double));
+  e.n = 0;
+
+  if (e.avgToAcquire && e.rows == e.avgToAcquire)
+    e.done = true;
+}
+
+unsigned BsaEngine::_row(const Edef& e, unsigned row) const
+{
+  return e.rows < e.capacity ? row : (e.head+row)%e.capacity;
+}
+
+unsigned BsaEngine::results(unsigned edef) const
+{
+  return edef < NEDEFS ? _edef[edef].rows : 0;
+}
+
+uint64_t BsaEngine::pulseId(unsigned edef, unsigned row) const
+{
+  if (edef >= NEDEFS || row >= _edef[edef].rows)
+    return 0;
+  const Edef& e = _edef[edef];
+  return e.pid[_row(e,row)];
+}
+
+uint64_t BsaEngine::timeStamp(unsigned edef, unsigned row) const
+{
+  if (edef >= NEDEFS || row >= _edef[edef].rows)
+    return 0;
+  const Edef& e = _edef[edef];
+  return e.ts[_row(e,row)];
+}
+
+unsigned BsaEngine::nSamples(unsigned edef, unsigned row) const
+{
+  if (edef >= NEDEFS || row >= _edef[edef].rows)
+    return 0;
+  const Edef& e = _edef[edef];
+  return e.ns[_row(e,row)];
+}
+
+const double* BsaEngine::mean(unsigned edef, unsigned row) const
+{
+  if (edef >= NEDEFS || row >= _edef[edef].rows)
+    return 0;
+  const Edef& e = _edef[edef];
+  return &e.meanv[_row(e,row)*_stride];
+}
+
+const double* BsaEngine::rms(unsigned edef, unsigned row) const
+{
+  if (edef >= NEDEFS || row >= _edef[edef].rows)
+    return 0;
+  const Edef& e = _edef[edef];
+  return &e.rmsv[_row(e,row)*_stride];
+}
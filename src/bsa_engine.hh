@@ -0,0 +1,86 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef TPR_BSAENGINE_HH
+#define TPR_BSAENGINE_HH
+
+//
+//  Software beam synchronous acquisition driven by the TPR's BSA segments.
+//
+//  Each pulse the application supplies one value per channel along with
+//  the pulse's BsaChannel segment.  For each EDEF set in newActive the
+//  values are added to that EDEF's running sums; an average is closed when
+//  the EDEF is set in newAvgDone (or nToAverage samples are reached) and
+//  stored as one result; the acquisition ends at newDone (or avgToAcquire
+//  results).  A BsaControl segment with the EDEF set in init restarts it.
+//
+//  Accumulators are kept per EDEF as arrays over channels, padded to the
+//  vector width, so each active EDEF costs two vector adds per channel
+//  group.  tpr_bsa measures the rate.
+//
+#include <stdint.h>
+
+#include <vector>
+
+namespace Tpr {
+  class BsaControl;
+  class BsaChannel;
+  class Segment;
+
+  class BsaEngine {
+  public:
+    enum { NEDEFS = 64 };
+    //  Results kept for avgToAcquire=0 (continuous); the oldest are overwritten
+    enum { CONTINUOUS_ROWS = 2800 };
+    BsaEngine(unsigned nchannels);
+    ~BsaEngine();
+  public:
+    //  Mirror of TPG::startBSA for the EDEF.  Returns negative on error.
+    int      start  (unsigned edef, unsigned nToAverage, unsigned avgToAcquire);
+    void     stop   (unsigned edef);
+  public:
+    void     control(const BsaControl&);
+    //  values[nChannels()] sampled on this pulse
+    void     channel(const BsaChannel&, const float* values);
+    //  Dispatches a BSA segment; other types are ignored
+    void     process(const Segment&, const float* values);
+  public:
+    unsigned nChannels() const { return _nch; }
+    //  EDEFs whose acquisition has ended since start or the last clearDone()
+    uint64_t doneMask () const { return _doneMask; }
+    void     clearDone() { _doneMask = 0; }
+    //  Results stored for the EDEF; for continuous acquisition row 0 is
+    //  the oldest retained.  The accessors return 0 for an EDEF or row
+    //  out of range.
+    unsigned results  (unsigned edef) const;
+    uint64_t pulseId  (unsigned edef, unsigned row) const;
+    uint64_t timeStamp(unsigned edef, unsigned row) const;
+    unsigned nSamples (unsigned edef, unsigned row) const;
+    //  Per channel mean and RMS deviation of one result
+    const double* mean(unsigned edef, unsigned row) const;
+    const double* rms (unsigned edef, unsigned row) const;
+  private:
+    class Edef;
+    void     _close (Edef&, const BsaChannel&);
+    unsigned _row   (const Edef&, unsigned row) const;
+  private:
+    BsaEngine(const BsaEngine&);
+    BsaEngine& operator=(const BsaEngine&);
+  private:
+    unsigned _nch;
+    unsigned _stride;   // _nch padded to the vector width
+    double*  _x;        // this pulse's values
+    double*  _x2;       // ..and their squares
+    Edef*    _edef;
+    uint64_t _enabled;
+    uint64_t _doneMask;
+  };
+};
+
+#endif
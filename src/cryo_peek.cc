@@ -21,6 +21,7 @@
 #include <cpsw_yaml.h>
 
 #include "hps_utils.hh"
+#include "yaml_cache.hh"
 
 using namespace Cphw;
 
@@ -60,7 +61,7 @@ int main(int argc, char* argv[])
   }
 
   IYamlFixup* fixup = new IpAddrFixup(ip);
-  Path path = IPath::loadYamlFile(yaml_file,"NetIODev",0,fixup);
+  Path path = YamlCache::load(yaml_file,"NetIODev",fixup,"mmio");
   delete fixup;
 
   unsigned v;
@@ -20,6 +20,7 @@
 #include <cpsw_yaml.h>
 
 #include "hps_utils.hh"
+#include "yaml_cache.hh"
 
 using namespace Cphw;
 
@@ -115,7 +116,7 @@ int main(int argc, char* argv[])
   }
 
   IYamlFixup* fixup = new IpAddrFixup(ip);
-  Path path = IPath::loadYamlFile(yaml_file,"NetIODev",0,fixup);
+  Path path = YamlCache::load(yaml_file,"NetIODev",fixup,yaml_path);
   delete fixup;
 
   Cphw::AmcTiming* t = new Cphw::AmcTiming(path->findByName(yaml_path));
@@ -15,31 +15,40 @@
 
 #include <string>
 #include <new>
+#include <vector>
 
 #include <cpsw_api_user.h>
 #include <cpsw_yaml_keydefs.h>
 #include <cpsw_yaml.h>
 
 #include "hps_utils.hh"
+#include "yaml_cache.hh"
 
 using namespace Cphw;
 
 void usage(const char* p) {
   printf("Usage: %s [options]\n",p);
-  printf("Options: -a <ip address, dotted notation>\n");
+  printf("Options: -a <ip address, dotted notation>[,<ip address>..]\n");
   printf("         -y <yaml file>[,<path to timing>]\n");
-  printf("         -f <filename>                  : Data output file\n");
+  printf("         -f <filename>                  : Data output file (<filename>.<ip address> for several)\n");
   printf("         -s                             : Sparse scan\n");
   printf("         -p <prescale>                  : Sample count prescale (2**(17+<prescale>))\n");
+  printf("         -b <max prescale>              : Adaptive scan: bisect for the eye boundary,\n");
+  printf("                                          refining it with prescale up to <max prescale>\n");
+  printf("Several addresses are scanned concurrently, with the adaptive scan\n");
 }
 
+static std::vector<Cphw::GthEyeScan*> scans;
+
 static void* progress(void*)
 {
   unsigned row, col;
   while(1) {
     sleep(60);
-    Cphw::GthEyeScan::progress(row,col);
-    printf("progress: %d,%d\n", row, col);
+    for(unsigned i=0; i<scans.size(); i++) {
+      scans[i]->progress(row,col);
+      printf("progress[%u]: %d,%d\n", i, row, col);
+    }
   }
   return 0;
 }
@@ -54,12 +63,14 @@ int main(int argc, char* argv[])
   unsigned prescale = 0;
   const char* outfile = "eyescan.dat";
   bool lsparse = false;
+  int  maxPrescale = -1;
   const char* yaml_file = 0;
   const char* yaml_path = "mmio/AmcCarrierCheckout";
 
-  while ( (c=getopt( argc, argv, "a:f:p:sy:h")) != EOF ) {
+  while ( (c=getopt( argc, argv, "a:b:f:p:sy:h")) != EOF ) {
     switch(c) {
     case 'a': ip = optarg; break;
+    case 'b': maxPrescale = strtoul(optarg,NULL,0); break;
     case 'f': outfile = optarg; break;
     case 'p': prescale = strtoul(optarg,NULL,0); break;
     case 's': lsparse = true; break;
@@ -78,12 +89,38 @@ int main(int argc, char* argv[])
     }
   }
 
-  IYamlFixup* fixup = new IpAddrFixup(ip);
-  Path path = IPath::loadYamlFile(yaml_file,"NetIODev",0,fixup);
-  delete fixup;
+  std::vector<std::string> ips;
+  for(const char* p = ip; *p; ) {
+    const char* q = strchr(p,',');
+    ips.push_back(q ? std::string(p,q-p) : std::string(p));
+    p = q ? q+1 : p+strlen(p);
+  }
+
+  Cphw::EyeScanScheduler sched;
+  std::vector<std::string> outfiles(ips.size());
+
+  for(unsigned i=0; i<ips.size(); i++) {
+    IYamlFixup* fixup = new IpAddrFixup(ips[i].c_str());
+    Path path = YamlCache::load(yaml_file,"NetIODev",fixup,yaml_path);
+    delete fixup;
 
-  Cphw::AmcTiming* t = new Cphw::AmcTiming(path->findByName(yaml_path));
-  printf("buildStamp %s\n",t->version().buildStamp().c_str());
+    Cphw::AmcTiming* t = new Cphw::AmcTiming(path->findByName(yaml_path));
+    printf("%s buildStamp %s\n",ips[i].c_str(),t->version().buildStamp().c_str());
+
+    //  Setup AMC
+    Cphw::GthEyeScan* gth = new Cphw::GthEyeScan(path->findByName(yaml_path));
+    if (!gth->enabled()) {
+      gth->enable(true);
+      // reset rx
+      t->bbReset();
+      sleep(1);
+    }
+    scans.push_back(gth);
+
+    outfiles[i] = ips.size()>1 ? std::string(outfile)+"."+ips[i] : std::string(outfile);
+    sched.add(gth, outfiles[i].c_str(), prescale,
+              maxPrescale < 0 ? prescale : maxPrescale, 1);
+  }
 
   pthread_attr_t tattr;
   pthread_attr_init(&tattr);
@@ -91,15 +128,12 @@ int main(int argc, char* argv[])
   if (pthread_create(&tid, &tattr, &progress, 0))
     perror("Error creating progress thread");
 
-  //  Setup AMC
-  Cphw::GthEyeScan* gth = new Cphw::GthEyeScan(path->findByName(yaml_path));
-  if (!gth->enabled()) {
-    gth->enable(true);
-    // reset rx
-    t->bbReset();
-    sleep(1);
-  }
-  gth->scan(outfile,prescale,1,lsparse);
+  if (scans.size()>1)
+    sched.run();
+  else if (maxPrescale >= 0)
+    scans[0]->adaptive(outfile,prescale,maxPrescale,1);
+  else
+    scans[0]->scan(outfile,prescale,1,lsparse);
 
   return 0;
 
@@ -12,6 +12,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <time.h>
+#include <signal.h>
 
 #include <string>
 #include <new>
@@ -21,17 +22,26 @@
 #include <cpsw_yaml.h>
 
 #include "hps_utils.hh"
+#include "yaml_cache.hh"
 
 using namespace Cphw;
 
+static volatile bool lrun = true;
+
+static void sigHandler(int)
+{
+  lrun = false;
+}
+
 void usage(const char* p) {
   printf("Usage: %s [options]\n",p);
   printf("Options: -a <ip address, dotted notation>\n");
   printf("         -y <yaml file>[,<path to timing>]\n");
   printf("         -d Dump raw timing stream\n");
   printf("         -D Dump framed timing\n");
+  printf("         -c <file>[,<n>] Stream n raw timing captures to file (default: until ^C)\n");
   printf("         -s Dump stats\n");
-  printf("         -S <secs>  Dump stats over seconds\n");
+  printf("         -S <secs>  Dump stats averaged over seconds (0: until interrupted)\n");
   printf("         -t <value> Set clkSel\n");
   printf("         -T <value> Set timingMode (track clkSel=-1)\n");
   printf("         -P <value> set polarity\n");
@@ -50,6 +60,8 @@ int main(int argc, char* argv[])
   bool dumpStats = false;
   int dumpStatsSecs = 0;
   bool lDump0=false, lDump1=false;
+  const char* capFile = 0;
+  unsigned    capN    = 0;
   const char* yaml_file = 0;
   const char* yaml_path = "mmio/AmcCarrierCheckout";
   int polarity = -1;
@@ -60,11 +72,16 @@ int main(int argc, char* argv[])
   bool lreset = false;
   bool lreload = false;
 
-  while ( (c=getopt( argc, argv, "a:dDP:X:hsS:t:T:y:rR")) != EOF ) {
+  while ( (c=getopt( argc, argv, "a:c:dDP:X:hsS:t:T:y:rR")) != EOF ) {
     switch(c) {
     case 'a':
       ip = optarg;
       break;
+    case 'c':
+      capFile = strtok(optarg,",");
+      if ((endptr = strtok(NULL,",")))
+        capN = strtoul(endptr,NULL,0);
+      break;
     case 'd':
       lDump0 = true;
       break;
@@ -119,7 +136,7 @@ int main(int argc, char* argv[])
   }
 
   IYamlFixup* fixup = new IpAddrFixup(ip);
-  Path path = IPath::loadYamlFile(yaml_file,"NetIODev",0,fixup);
+  Path path = YamlCache::load(yaml_file,"NetIODev",fixup,yaml_path);
   delete fixup;
 
   //  unsigned ilcls = lcls2 ? 1:0;
@@ -166,48 +183,65 @@ int main(int argc, char* argv[])
   if (lDump1)
     t->ring1().clear_and_dump(100000);
 
+  if (capFile) {
+    FILE* f = fopen(capFile,"w");
+    if (!f) {
+      perror(capFile);
+      return -1;
+    }
+    ::signal( SIGINT, sigHandler );
+    struct timespec tv_begin, tv_end;
+    clock_gettime(CLOCK_REALTIME, &tv_begin);
+    unsigned n = t->ring0().stream(f, 100, capN, &lrun);
+    clock_gettime(CLOCK_REALTIME, &tv_end);
+    double dt = double(tv_end.tv_sec - tv_begin.tv_sec) + 1.e-9*(double(tv_end.tv_nsec)-double(tv_begin.tv_nsec));
+    printf("%u captures in %.1f s\n", n, dt);
+    fclose(f);
+  }
+
 
   //
   //  Check Link Up, Frame counters (TPR link_test)
   //
   if (dumpStats) {
-    Cphw::TimingStats s0, s1;
-    struct timespec tv_begin, tv_end;
-    clock_gettime(CLOCK_REALTIME, &tv_begin);
-    s0 = t->getStats();
-
-    do {
-      usleep(1000000);
-
-      clock_gettime(CLOCK_REALTIME, &tv_end);
-      s1 = t->getStats();
-      double dt = double(tv_end.tv_sec - tv_begin.tv_sec) + 1.e-9*(double(tv_end.tv_nsec)-double(tv_begin.tv_nsec));
-      if (dumpStatsSecs==1) {
-        double rxClkFreq = double(s1.rxclks-s0.rxclks)*16.e-6 / dt;
+    Cphw::TimingMonitor m(*t);
+    Cphw::TimingRates   r;
+    r.seq = 0;
+    m.start();
+
+    //  As before the monitor: rates are averaged from the first sample,
+    //  and the clock frequencies are shown on the last.  0 runs until
+    //  interrupted.
+    double t=0, sof=0, crc=0, dec=0, dsp=0, rxClk=0, txClk=0;
+    for(int n=dumpStatsSecs; m.wait(r.seq, r); ) {
+      t     += r.dt;
+      sof   += r.sof     *r.dt;
+      crc   += r.crc     *r.dt;
+      dec   += r.dec     *r.dt;
+      dsp   += r.dsp     *r.dt;
+      rxClk += r.rxClkMHz*r.dt;
+      txClk += r.txClkMHz*r.dt;
+
+      if (n==1) {
         printf("RxRecClkFreq: %7.2f\n", 
-               rxClkFreq);
-        double txClkFreq = double(s1.txclks-s0.txclks)*16.e-6 / dt;
+               rxClk/t);
         printf("TxRefClkFreq: %7.2f\n", 
-               txClkFreq);
-      
+               txClk/t);
       }
-
       printf("Link        : %s\n",
-             s1.linkup ? "Up  " : "Down");
-      printf("RxPolarity  : %u\n", s1.polarity);
-      double sofCnts = double(s1.sof-s0.sof) / dt;
+             r.linkup ? "Up  " : "Down");
+      printf("RxPolarity  : %u\n", r.polarity);
       printf("SOFcounts   : %7.0f\n",
-             sofCnts);
-      double crcErrs = double(s1.crc-s0.crc) / dt;
+             sof/t);
       printf("CRCerrors   : %7.0f\n",
-             crcErrs);
-      double decErrs = double(s1.dec-s0.dec) / dt;
+             crc/t);
       printf("DECerrors   : %7.0f\n",
-             decErrs);
-      double dspErrs = double(s1.dsp-s0.dsp) / dt;
+             dec/t);
       printf("DSPerrors   : %7.0f\n",
-             dspErrs);
-    } while(--dumpStatsSecs);
+             dsp/t);
+      if (n && --n==0)
+        break;
+    }
   }
 
   if (lreset) 
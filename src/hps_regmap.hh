@@ -0,0 +1,158 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'tpg', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+//
+//  Generated by scripts/yaml_regmap.py from
+//    ../yaml/000TopLevel.yaml
+//    ../yamlb/000TopLevel.yaml
+//  Do not edit; make regenerates it when the yaml changes.
+//
+#ifndef hps_regmap_hh
+#define hps_regmap_hh
+
+#include "regmap.hh"
+
+namespace Cphw {
+  namespace Regs {
+    namespace AmcCarrierDRAM {
+      enum { NREGS = 1 };
+      constexpr RegDesc dram = {   0, "dram",  536870912, RegDesc::RW };  // 0x00000000
+    };
+    namespace AxiSy56040 {
+      enum { NREGS = 1 };
+      constexpr RegDesc OutputConfig = {   0, "OutputConfig",          4, RegDesc::RW };  // 0x00000000
+    };
+    namespace AxiVersion {
+      enum { NREGS = 13 };
+      constexpr RegDesc FpgaVersion       = {   0, "FpgaVersion"      ,          1, RegDesc::RO };  // 0x00000000
+      constexpr RegDesc ScratchPad        = {   1, "ScratchPad"       ,          1, RegDesc::RW };  // 0x00000004
+      constexpr RegDesc UpTimeCnt         = {   2, "UpTimeCnt"        ,          1, RegDesc::RO };  // 0x00000008
+      constexpr RegDesc FpgaReloadHalt    = {   3, "FpgaReloadHalt"   ,          1, RegDesc::RW };  // 0x00000100
+      constexpr RegDesc FpgaReload        = {   4, "FpgaReload"       ,          1, RegDesc::RW };  // 0x00000104
+      constexpr RegDesc FpgaReloadAddress = {   5, "FpgaReloadAddress",          1, RegDesc::RW };  // 0x00000108
+      constexpr RegDesc MasterReset       = {   6, "MasterReset"      ,          1, RegDesc::WO };  // 0x0000010c
+      constexpr RegDesc FdSerial          = {   7, "FdSerial"         ,          1, RegDesc::RO };  // 0x00000300
+      constexpr RegDesc UserConstants     = {   8, "UserConstants"    ,         64, RegDesc::RO };  // 0x00000400
+      constexpr RegDesc DeviceId          = {   9, "DeviceId"         ,          1, RegDesc::RO };  // 0x00000500
+      constexpr RegDesc GitHash           = {  10, "GitHash"          ,          1, RegDesc::RO };  // 0x00000600
+      constexpr RegDesc DeviceDna         = {  11, "DeviceDna"        ,          1, RegDesc::RO };  // 0x00000700
+      constexpr RegDesc BuildStamp        = {  12, "BuildStamp"       ,        256, RegDesc::RO };  // 0x00000800
+    };
+    namespace AxilRingBuffer {
+      enum { NREGS = 2 };
+      constexpr RegDesc csr  = {   0, "csr" ,          1, RegDesc::RW };  // 0x00000000
+      constexpr RegDesc dump = {   1, "dump",       1023, RegDesc::RW };  // 0x00000004
+    };
+    namespace GthEyeScan {
+      enum { NREGS = 17 };
+      constexpr RegDesc Prescale    = {   0, "Prescale"   ,          1, RegDesc::RW };  // 0x000000f0
+      constexpr RegDesc Enable      = {   1, "Enable"     ,          1, RegDesc::RW };  // 0x000000f1
+      constexpr RegDesc ErrDetEn    = {   2, "ErrDetEn"   ,          1, RegDesc::RW };  // 0x000000f1
+      constexpr RegDesc Run         = {   3, "Run"        ,          1, RegDesc::RW };  // 0x000000f1
+      constexpr RegDesc Qualifier   = {   4, "Qualifier"  ,          5, RegDesc::RW };  // 0x000000fc
+      constexpr RegDesc QualMask    = {   5, "QualMask"   ,          5, RegDesc::RW };  // 0x00000110
+      constexpr RegDesc SDataMask   = {   6, "SDataMask"  ,          5, RegDesc::RW };  // 0x00000124
+      constexpr RegDesc HorzOffset  = {   7, "HorzOffset" ,          1, RegDesc::RW };  // 0x0000013c
+      constexpr RegDesc EsVsRange   = {   8, "EsVsRange"  ,          1, RegDesc::RW };  // 0x0000025c
+      constexpr RegDesc EsVsCode    = {   9, "EsVsCode"   ,          1, RegDesc::RW };  // 0x0000025c
+      constexpr RegDesc VertOffset  = {  10, "VertOffset" ,          1, RegDesc::RW };  // 0x0000025c
+      constexpr RegDesc EsVsUtSign  = {  11, "EsVsUtSign" ,          1, RegDesc::RW };  // 0x0000025d
+      constexpr RegDesc EsVsNegDir  = {  12, "EsVsNegDir" ,          1, RegDesc::RW };  // 0x0000025d
+      constexpr RegDesc ErrorCount  = {  13, "ErrorCount" ,          1, RegDesc::RO };  // 0x00000544
+      constexpr RegDesc SampleCount = {  14, "SampleCount",          1, RegDesc::RO };  // 0x00000548
+      constexpr RegDesc ScanDone    = {  15, "ScanDone"   ,          1, RegDesc::RO };  // 0x0000054c
+      constexpr RegDesc ScanState   = {  16, "ScanState"  ,          1, RegDesc::RO };  // 0x0000054c
+    };
+    namespace GthRxAlignCheck {
+      enum { NREGS = 5 };
+      constexpr RegDesc PhaseCount  = {   0, "PhaseCount" ,         40, RegDesc::RO };  // 0x00000000
+      constexpr RegDesc PhaseTarget = {   1, "PhaseTarget",          1, RegDesc::RW };  // 0x00000100
+      constexpr RegDesc PhaseMask   = {   2, "PhaseMask"  ,          1, RegDesc::RW };  // 0x00000101
+      constexpr RegDesc ResetLen    = {   3, "ResetLen"   ,          1, RegDesc::RW };  // 0x00000102
+      constexpr RegDesc LastPhase   = {   4, "LastPhase"  ,          1, RegDesc::RO };  // 0x00000104
+    };
+    namespace TPGMiniCore {
+      enum { NREGS = 46 };
+      constexpr RegDesc TxPolarity           = {   0, "TxPolarity"          ,          1, RegDesc::RW };  // 0x00000000
+      constexpr RegDesc TxLoopback           = {   1, "TxLoopback"          ,          1, RegDesc::RW };  // 0x00000000
+      constexpr RegDesc TxInhibit            = {   2, "TxInhibit"           ,          1, RegDesc::RW };  // 0x00000000
+      constexpr RegDesc BaseControl          = {   3, "BaseControl"         ,          1, RegDesc::RW };  // 0x00000004
+      constexpr RegDesc PulseIdRd            = {   4, "PulseIdRd"           ,          1, RegDesc::RO };  // 0x00000008
+      constexpr RegDesc TStampRd             = {   5, "TStampRd"            ,          1, RegDesc::RO };  // 0x00000010
+      constexpr RegDesc FixedRateDiv         = {   6, "FixedRateDiv"        ,         10, RegDesc::RW };  // 0x00000018
+      constexpr RegDesc RateReload           = {   7, "RateReload"          ,          1, RegDesc::RW };  // 0x00000040
+      constexpr RegDesc NBeamSeq             = {   8, "NBeamSeq"            ,          1, RegDesc::RO };  // 0x0000004c
+      constexpr RegDesc NControlSeq          = {   9, "NControlSeq"         ,          1, RegDesc::RO };  // 0x0000004c
+      constexpr RegDesc NArraysBsa           = {  10, "NArraysBsa"          ,          1, RegDesc::RO };  // 0x0000004d
+      constexpr RegDesc SeqAddrLen           = {  11, "SeqAddrLen"          ,          1, RegDesc::RO };  // 0x0000004e
+      constexpr RegDesc NAllowSeq            = {  12, "NAllowSeq"           ,          1, RegDesc::RO };  // 0x0000004f
+      constexpr RegDesc BsaCompleteRd        = {  13, "BsaCompleteRd"       ,          1, RegDesc::RO };  // 0x00000050
+      constexpr RegDesc BsaCompleteWr        = {  14, "BsaCompleteWr"       ,          1, RegDesc::RW };  // 0x00000050
+      constexpr RegDesc PulseIdWr            = {  15, "PulseIdWr"           ,          1, RegDesc::RW };  // 0x00000058
+      constexpr RegDesc TStampWr             = {  16, "TStampWr"            ,          1, RegDesc::RW };  // 0x00000060
+      constexpr RegDesc TxReset              = {  17, "TxReset"             ,          1, RegDesc::RW };  // 0x00000068
+      constexpr RegDesc CountIntervalReset   = {  18, "CountIntervalReset"  ,          1, RegDesc::RW };  // 0x0000006c
+      constexpr RegDesc PulseIdSet           = {  19, "PulseIdSet"          ,          1, RegDesc::RW };  // 0x00000070
+      constexpr RegDesc TStampSet            = {  20, "TStampSet"           ,          1, RegDesc::RW };  // 0x00000074
+      constexpr RegDesc Lcls1BsaNumSamples   = {  21, "Lcls1BsaNumSamples"  ,          1, RegDesc::RW };  // 0x00000078
+      constexpr RegDesc Lcls1BsaRate         = {  22, "Lcls1BsaRate"        ,          1, RegDesc::RW };  // 0x00000079
+      constexpr RegDesc Lcls1BsaTimeSlot     = {  23, "Lcls1BsaTimeSlot"    ,          1, RegDesc::RW };  // 0x00000079
+      constexpr RegDesc Lcls1BsaSeverity     = {  24, "Lcls1BsaSeverity"    ,          1, RegDesc::RW };  // 0x0000007a
+      constexpr RegDesc Lcls1BsaEdefSlot     = {  25, "Lcls1BsaEdefSlot"    ,          1, RegDesc::RW };  // 0x0000007a
+      constexpr RegDesc Lcls1BsaNumAvgs      = {  26, "Lcls1BsaNumAvgs"     ,          1, RegDesc::RW };  // 0x0000007b
+      constexpr RegDesc Lcls1BsaStart        = {  27, "Lcls1BsaStart"       ,          1, RegDesc::RW };  // 0x0000007c
+      constexpr RegDesc BsaActive            = {  28, "BsaActive"           ,          2, RegDesc::RW };  // 0x000001fc
+      constexpr RegDesc BsaRateSelMode       = {  29, "BsaRateSelMode"      ,          2, RegDesc::RW };  // 0x00000200
+      constexpr RegDesc BsaFixedRate         = {  30, "BsaFixedRate"        ,          2, RegDesc::RW };  // 0x00000200
+      constexpr RegDesc BsaACRate            = {  31, "BsaACRate"           ,          2, RegDesc::RW };  // 0x00000200
+      constexpr RegDesc BsaACTSMask          = {  32, "BsaACTSMask"         ,          2, RegDesc::RW };  // 0x00000201
+      constexpr RegDesc BsaSequenceSelect    = {  33, "BsaSequenceSelect"   ,          2, RegDesc::RW };  // 0x00000201
+      constexpr RegDesc BsaSequenceBitSelect = {  34, "BsaSequenceBitSelect",          2, RegDesc::RW };  // 0x00000202
+      constexpr RegDesc BsaDestMode          = {  35, "BsaDestMode"         ,          2, RegDesc::RW };  // 0x00000203
+      constexpr RegDesc BsaDestInclusiveMask = {  36, "BsaDestInclusiveMask",          2, RegDesc::RW };  // 0x00000204
+      constexpr RegDesc BsaDestExclusiveMask = {  37, "BsaDestExclusiveMask",          2, RegDesc::RW };  // 0x00000206
+      constexpr RegDesc BsaNtoAvg            = {  38, "BsaNtoAvg"           ,          2, RegDesc::RW };  // 0x00000208
+      constexpr RegDesc BsaMaxSeverity       = {  39, "BsaMaxSeverity"      ,          2, RegDesc::RW };  // 0x00000209
+      constexpr RegDesc BsaAvgToWr           = {  40, "BsaAvgToWr"          ,          2, RegDesc::RW };  // 0x0000020a
+      constexpr RegDesc PllCnt               = {  41, "PllCnt"              ,          1, RegDesc::RO };  // 0x00000500
+      constexpr RegDesc ClkCnt               = {  42, "ClkCnt"              ,          1, RegDesc::RO };  // 0x00000504
+      constexpr RegDesc SyncErrCnt           = {  43, "SyncErrCnt"          ,          1, RegDesc::RO };  // 0x00000508
+      constexpr RegDesc CountInterval        = {  44, "CountInterval"       ,          1, RegDesc::RW };  // 0x0000050c
+      constexpr RegDesc BaseRateCount        = {  45, "BaseRateCount"       ,          1, RegDesc::RO };  // 0x00000510
+    };
+    namespace TimingFrameRx {
+      enum { NREGS = 23 };
+      constexpr RegDesc sofCount         = {   0, "sofCount"        ,          1, RegDesc::RO };  // 0x00000000
+      constexpr RegDesc eofCount         = {   1, "eofCount"        ,          1, RegDesc::RO };  // 0x00000004
+      constexpr RegDesc FidCount         = {   2, "FidCount"        ,          1, RegDesc::RO };  // 0x00000008
+      constexpr RegDesc CrcErrCount      = {   3, "CrcErrCount"     ,          1, RegDesc::RO };  // 0x0000000c
+      constexpr RegDesc RxClkCount       = {   4, "RxClkCount"      ,          1, RegDesc::RO };  // 0x00000010
+      constexpr RegDesc RxRstCount       = {   5, "RxRstCount"      ,          1, RegDesc::RO };  // 0x00000014
+      constexpr RegDesc RxDecErrCount    = {   6, "RxDecErrCount"   ,          1, RegDesc::RO };  // 0x00000018
+      constexpr RegDesc RxDspErrCount    = {   7, "RxDspErrCount"   ,          1, RegDesc::RO };  // 0x0000001c
+      constexpr RegDesc RxCountReset     = {   8, "RxCountReset"    ,          1, RegDesc::RW };  // 0x00000020
+      constexpr RegDesc RxLinkUp         = {   9, "RxLinkUp"        ,          1, RegDesc::RO };  // 0x00000020
+      constexpr RegDesc RxPolarity       = {  10, "RxPolarity"      ,          1, RegDesc::RW };  // 0x00000020
+      constexpr RegDesc RxReset          = {  11, "RxReset"         ,          1, RegDesc::RW };  // 0x00000020
+      constexpr RegDesc ClkSel           = {  12, "ClkSel"          ,          1, RegDesc::RW };  // 0x00000020
+      constexpr RegDesc RxDown           = {  13, "RxDown"          ,          1, RegDesc::RW };  // 0x00000020
+      constexpr RegDesc BypassRst        = {  14, "BypassRst"       ,          1, RegDesc::RW };  // 0x00000020
+      constexpr RegDesc VersionErr       = {  15, "VersionErr"      ,          1, RegDesc::RO };  // 0x00000021
+      constexpr RegDesc ModeSel          = {  16, "ModeSel"         ,          1, RegDesc::RW };  // 0x00000021
+      constexpr RegDesc ModeSelEn        = {  17, "ModeSelEn"       ,          1, RegDesc::RW };  // 0x00000021
+      constexpr RegDesc MsgDelay         = {  18, "MsgDelay"        ,          1, RegDesc::RW };  // 0x00000024
+      constexpr RegDesc TxClkCount       = {  19, "TxClkCount"      ,          1, RegDesc::RO };  // 0x00000028
+      constexpr RegDesc BypassDoneCount  = {  20, "BypassDoneCount" ,          1, RegDesc::RO };  // 0x0000002c
+      constexpr RegDesc BypassResetCount = {  21, "BypassResetCount",          1, RegDesc::RO };  // 0x0000002e
+      constexpr RegDesc FrameVersion     = {  22, "FrameVersion"    ,          1, RegDesc::RO };  // 0x00000030
+    };
+  };
+};
+
+#endif
@@ -66,7 +66,12 @@ void XBar::dump  () const
 
 RingBuffer::RingBuffer(Path root) :
   _csr (IScalVal::create(root->findByName("csr"))),
-  _dump(IScalVal::create(root->findByName("dump")))
+  _dump(IScalVal::create(root->findByName("dump"))),
+  _buff(MAXLEN)
+{
+}
+
+RingBuffer::~RingBuffer()
 {
 }
 
@@ -91,28 +96,39 @@ void RingBuffer::clear()
   _csr->setVal(&r);
 }
 
-void RingBuffer::dump()
+unsigned RingBuffer::length() const
 {
   unsigned len;
   _csr->getVal(&len);
   unsigned wid = (len>>20)&0xff;
   len &= (1<<wid)-1;
-  printf("[wid=%x,len=%x]\n",wid,len);
   //  firmware only captures to a max length of 0x3ff words
-  if (len>0x3ff) len=0x3ff;
-  uint32_t* buff = new uint32_t[len];
-  //  _dump->getVal(buff,len);
-  //  for(unsigned i=0; i<len; i++)
-  //    printf("%08x%c", buff[i], (i&0x7)==0x7 ? '\n':' ');
-  //  printf("%08x\n", _dump->getVal(buff));
-
-  for(unsigned i=0; i<len; i++) {
-    IndexRange range(i);
-    _dump->getVal(&buff[i],1,&range);
-    printf("%08x%c", buff[i], (i&0x7)==0x7 ? '\n':' ');
+  if (len>MAXLEN) len=MAXLEN;
+  return len;
+}
+
+const uint32_t* RingBuffer::read(unsigned len)
+{
+  if (len>MAXLEN) len=MAXLEN;
+  for(unsigned i=0; i<len; i+=CHUNK) {
+    unsigned n = len-i < CHUNK ? len-i : CHUNK;
+    IndexRange range(i, i+n-1);
+    _dump->getVal(&_buff[i],n,&range);
   }
+  return _buff.data();
+}
 
-  delete[] buff;
+void RingBuffer::decode(FILE* f, const uint32_t* buff, unsigned len) const
+{
+  for(unsigned i=0; i<len; i++)
+    fprintf(f, "%08x%c", buff[i], (i&0x7)==0x7 ? '\n':' ');
+}
+
+void RingBuffer::dump()
+{
+  unsigned len = length();
+  printf("[len=%x]\n",len);
+  decode(stdout, read(len), len);
 }
 
 void RingBuffer::clear_and_dump(unsigned wait_us)
@@ -125,90 +141,134 @@ void RingBuffer::clear_and_dump(unsigned wait_us)
   dump();
 }
 
+unsigned RingBuffer::stream(FILE* f, unsigned wait_us, unsigned n, volatile bool* run)
+{
+  //  The control bits are ours for the duration, so the csr is read once
+  //  and each capture costs four writes
+  unsigned r;
+  _csr->getVal(&r);
+  r &= ~(3<<30);
+  unsigned off = r, clr = r|(1<<30), on = r|(1<<31);
+
+  unsigned ncap = 0;
+  while((n==0 || ncap<n) && (!run || *run)) {
+    _csr->setVal(&off);
+    _csr->setVal(&clr);
+    _csr->setVal(&off);
+    _csr->setVal(&on);
+    usleep(wait_us);
+    _csr->setVal(&off);
+
+    unsigned len = length();
+    const uint32_t* buff = read(len);
+    if (fwrite(&len, sizeof(len), 1, f) != 1 ||
+        fwrite(buff, sizeof(*buff), len, f) != len) {
+      perror("RingBuffer::stream");
+      break;
+    }
+    ncap++;
+  }
+  fflush(f);
+  return ncap;
+}
+
+namespace FrameRx = Cphw::Regs::TimingFrameRx;
+
 AmcTiming::AmcTiming(Path root) : 
   _root(root), 
   _timingRx(root->findByName("TimingFrameRx")),
-  _alignRx (root->findByName("GthRxAlignCheck"))
+  _alignRx (root->findByName("GthRxAlignCheck")),
+  _frameRx (_timingRx, FrameRx::NREGS)
+{
+  //  Resolve the counters up front, rather than on the first getStats
+  _frameRx.ro(FrameRx::sofCount);
+  _frameRx.ro(FrameRx::CrcErrCount);
+  _frameRx.ro(FrameRx::RxClkCount);
+  _frameRx.ro(FrameRx::RxDecErrCount);
+  _frameRx.ro(FrameRx::RxDspErrCount);
+  _frameRx.ro(FrameRx::RxLinkUp);
+  _frameRx.ro(FrameRx::RxPolarity);
+  _frameRx.ro(FrameRx::TxClkCount);
+}
+
+unsigned AmcTiming::_get(const RegDesc& r) const
+{
+  unsigned u;
+  _frameRx.ro(r)->getVal(&u);
+  return u;
+}
+
+void AmcTiming::_set(const RegDesc& r, unsigned u)
 {
+  _frameRx.rw(r)->setVal(&u);
 }
 
 void AmcTiming::setPolarity(bool inverted)
 {
-  unsigned u = inverted ? 1:0;
-  IScalVal::create(_timingRx->findByName("RxPolarity"))->setVal(&u);
+  _set(FrameRx::RxPolarity, inverted ? 1:0);
 }
 
 void AmcTiming::setLCLS()
 {
-  unsigned u = 0;
-  IScalVal::create(_timingRx->findByName("ClkSel"))->setVal(&u);
+  _set(FrameRx::ClkSel, 0);
 }
 
 void AmcTiming::setLCLSII()
 {
-  unsigned u = 1;
-  IScalVal::create(_timingRx->findByName("ClkSel"))->setVal(&u);
+  _set(FrameRx::ClkSel, 1);
 }
 
 void AmcTiming::bbReset()
 {
-  unsigned u=1;
-  IScalVal::create(_timingRx->findByName("RxReset"))->setVal(&u);
+  _set(FrameRx::RxReset, 1);
   usleep(10);
-  u=0;
-  IScalVal::create(_timingRx->findByName("RxReset"))->setVal(&u);
+  _set(FrameRx::RxReset, 0);
 }
 
 void AmcTiming::resetStats()
 {
-  unsigned u=1;
-  IScalVal::create(_timingRx->findByName("RxCountReset"))->setVal(&u);
+  _set(FrameRx::RxCountReset, 1);
   usleep(10);
-  u=0;
-  IScalVal::create(_timingRx->findByName("RxCountReset"))->setVal(&u);
+  _set(FrameRx::RxCountReset, 0);
 }
 
 TimingStats AmcTiming::getStats() const
 {
   TimingStats s;
 
-#define PR(r,u) { IScalVal_RO::create(_timingRx->findByName(#r))->getVal(&u); }
-  
-  PR(RxClkCount   ,s.rxclks);
-  PR(TxClkCount   ,s.txclks);
-  PR(sofCount     ,s.sof);
-  PR(RxLinkUp     ,s.linkup);
-  PR(RxPolarity   ,s.polarity);
-  PR(CrcErrCount  ,s.crc);
-  PR(RxDspErrCount,s.dsp);
-  PR(RxDspErrCount,s.dec);
-#undef PR
+  //  In register order
+  s.sof      = _get(FrameRx::sofCount);
+  s.crc      = _get(FrameRx::CrcErrCount);
+  s.rxclks   = _get(FrameRx::RxClkCount);
+  s.dec      = _get(FrameRx::RxDecErrCount);
+  s.dsp      = _get(FrameRx::RxDspErrCount);
+  s.linkup   = _get(FrameRx::RxLinkUp);
+  s.polarity = _get(FrameRx::RxPolarity);
+  s.txclks   = _get(FrameRx::TxClkCount);
 
   return s;
 }
 
 void AmcTiming::dumpStats() const
 {
-#define PR(r) { unsigned u;                                     \
-    IScalVal_RO::create(_timingRx->findByName(#r))->getVal(&u);   \
-    printf("%10.10s: 0x%x\n",#r,u); }
-  
-  PR(sofCount);
-  PR(eofCount);
-  PR(FidCount);
-  PR(CrcErrCount);
-  PR(RxClkCount);
-  PR(RxRstCount);
-  PR(RxDecErrCount);
-  PR(RxDspErrCount);
-  PR(RxLinkUp);
-  PR(RxPolarity);
-  PR(ClkSel);
-  PR(VersionErr);
-  PR(MsgDelay);
-  PR(TxClkCount);
-  PR(BypassDoneCount);
-#undef PR
+  static const RegDesc* regs[] = {
+    &FrameRx::sofCount,
+    &FrameRx::eofCount,
+    &FrameRx::FidCount,
+    &FrameRx::CrcErrCount,
+    &FrameRx::RxClkCount,
+    &FrameRx::RxRstCount,
+    &FrameRx::RxDecErrCount,
+    &FrameRx::RxDspErrCount,
+    &FrameRx::RxLinkUp,
+    &FrameRx::RxPolarity,
+    &FrameRx::ClkSel,
+    &FrameRx::VersionErr,
+    &FrameRx::MsgDelay,
+    &FrameRx::TxClkCount,
+    &FrameRx::BypassDoneCount };
+  for(unsigned i=0; i<sizeof(regs)/sizeof(regs[0]); i++)
+    printf("%10.10s: 0x%x\n",regs[i]->path,_get(*regs[i]));
 }
 
 void AmcTiming::setRxAlignTarget(unsigned t)
@@ -241,40 +301,208 @@ void AmcTiming::dumpRxAlign     () const
 
 void AmcTiming::measureClks() const
 {
-  double n=0;
-  double rx1=0, rx2=0;
-  double tx1=0, tx2=0;
+  TimingMonitor m(*this);
+  if (m.start())
+    return;
 
-  while(1) {
-    unsigned rxT0, txT0;
-    IScalVal_RO::create(_timingRx->findByName("RxClkCount"))->getVal(&rxT0);
-    IScalVal_RO::create(_timingRx->findByName("TxClkCount"))->getVal(&txT0);
-    usleep(1000000);
-
-    unsigned rxT1, txT1;
-    IScalVal_RO::create(_timingRx->findByName("RxClkCount"))->getVal(&rxT1);
-    IScalVal_RO::create(_timingRx->findByName("TxClkCount"))->getVal(&txT1);
-    double dRxT = double((rxT1 - rxT0) << 4);
-    double dTxT = double((txT1 - txT0) << 4);
-
-    n++; 
-    rx1 += dRxT; rx2 += dRxT*dRxT;
-    tx1 += dTxT; tx2 += dTxT*dTxT;
+  double n=0;
+  double rxm=0, rxq=0;
+  double txm=0, txq=0;
+
+  TimingRates r;
+  r.seq = 0;
+  while(m.wait(r.seq, r)) {
+    //  Welford's running mean and variance, in Hz
+    double dRxT = r.rxClkMHz*1.e6;
+    double dTxT = r.txClkMHz*1.e6;
+    n++;
+    double drx = dRxT-rxm; rxm += drx/n; rxq += drx*(dRxT-rxm);
+    double dtx = dTxT-txm; txm += dtx/n; txq += dtx*(dTxT-txm);
     printf("\n");
-    double rxm = rx1/n;
-    double rxs = n>1 ? sqrt((rx2-rxm*rx1)/(n-1)) : 0;
+    double rxs = n>1 ? sqrt(rxq/(n-1)) : 0;
     printf("%10.10s: mean %f  rms %f\n","1S dT(rx)", rxm*1.e-6, rxs*1.e-6);
-    double txm = tx1/n;
-    double txs = n>1 ? sqrt((tx2-txm*tx1)/(n-1)) : 0;
+    double txs = n>1 ? sqrt(txq/(n-1)) : 0;
     printf("%10.10s: mean %f  rms %f\n","1S dT(rx)", txm*1.e-6, txs*1.e-6);
   }
 }
 
+static double _dt(const timespec& a, const timespec& b)
+{
+  return double(b.tv_sec-a.tv_sec) + 1.e-9*(double(b.tv_nsec)-double(a.tv_nsec));
+}
+
+TimingMonitor::TimingMonitor(const AmcTiming& t, unsigned periodMs, unsigned depth) :
+  _timing  (t),
+  _periodMs(periodMs),
+  _ring    (depth ? depth : 1),
+  _seq     (0),
+  _primed  (false),
+  _running (false)
+{
+  pthread_mutex_init(&_lock, 0);
+  pthread_condattr_t cattr;
+  pthread_condattr_init(&cattr);
+  pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+  pthread_cond_init(&_cond, &cattr);
+  pthread_condattr_destroy(&cattr);
+}
+
+TimingMonitor::~TimingMonitor()
+{
+  stop();
+  pthread_cond_destroy (&_cond);
+  pthread_mutex_destroy(&_lock);
+}
+
+bool TimingMonitor::sample()
+{
+  timespec now, wall;
+  TimingStats s = _timing.getStats();
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  clock_gettime(CLOCK_REALTIME , &wall);
+
+  if (!_primed) {
+    _last     = s;
+    _lastTime = now;
+    _primed   = true;
+    return false;
+  }
+
+  TimingRates r;
+  r.time     = wall;
+  r.dt       = _dt(_lastTime, now);
+  r.linkup   = s.linkup;
+  r.polarity = s.polarity;
+  double f   = r.dt > 0 ? 1./r.dt : 0;
+  //  unsigned differences are modulo 2^32
+  r.sof      = double(unsigned(s.sof   -_last.sof   ))*f;
+  r.crc      = double(unsigned(s.crc   -_last.crc   ))*f;
+  r.dec      = double(unsigned(s.dec   -_last.dec   ))*f;
+  r.dsp      = double(unsigned(s.dsp   -_last.dsp   ))*f;
+  //  clock counters tick every 16 cycles
+  r.rxClkMHz = double(unsigned(s.rxclks-_last.rxclks))*16.e-6*f;
+  r.txClkMHz = double(unsigned(s.txclks-_last.txclks))*16.e-6*f;
+  _last     = s;
+  _lastTime = now;
+
+  pthread_mutex_lock(&_lock);
+  r.seq = ++_seq;
+  _ring[r.seq % _ring.size()] = r;
+  pthread_cond_broadcast(&_cond);
+  pthread_mutex_unlock(&_lock);
+  return true;
+}
+
+void* TimingMonitor::_run(void* p)
+{
+  TimingMonitor* m = reinterpret_cast<TimingMonitor*>(p);
+  timespec next;
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  while(m->_running) {
+    m->sample();
+    //  Absolute deadlines, so the period does not drift with read time
+    next.tv_nsec += (m->_periodMs%1000)*1000000;
+    next.tv_sec  += m->_periodMs/1000 + next.tv_nsec/1000000000;
+    next.tv_nsec %= 1000000000;
+    while(m->_running &&
+          clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, 0))
+      ;
+  }
+  return 0;
+}
+
+int TimingMonitor::start()
+{
+  if (_running)
+    return 0;
+  _running = true;
+  if (pthread_create(&_thread, 0, _run, this)) {
+    perror("TimingMonitor: pthread_create");
+    _running = false;
+    return -1;
+  }
+  return 0;
+}
+
+void TimingMonitor::stop()
+{
+  if (!_running)
+    return;
+  _running = false;
+  pthread_join(_thread, 0);
+  //  Release waiting clients
+  pthread_mutex_lock(&_lock);
+  pthread_cond_broadcast(&_cond);
+  pthread_mutex_unlock(&_lock);
+}
+
+bool TimingMonitor::latest(TimingRates& r) const
+{
+  pthread_mutex_lock(&_lock);
+  bool v = _seq > 0;
+  if (v)
+    r = _ring[_seq % _ring.size()];
+  pthread_mutex_unlock(&_lock);
+  return v;
+}
+
+bool TimingMonitor::wait(uint64_t seq, TimingRates& r, int timeoutMs) const
+{
+  timespec tmo;
+  clock_gettime(CLOCK_MONOTONIC, &tmo);
+  if (timeoutMs >= 0) {
+    tmo.tv_nsec += (timeoutMs%1000)*1000000;
+    tmo.tv_sec  += timeoutMs/1000 + tmo.tv_nsec/1000000000;
+    tmo.tv_nsec %= 1000000000;
+  }
+
+  pthread_mutex_lock(&_lock);
+  while(_seq <= seq && _running) {
+    if (timeoutMs < 0)
+      pthread_cond_wait(&_cond, &_lock);
+    else if (pthread_cond_timedwait(&_cond, &_lock, &tmo))
+      break;
+  }
+  bool v = _seq > seq;
+  if (v) {
+    //  A client that fell behind the ring gets the oldest still held
+    uint64_t next = seq+1;
+    if (_seq - next >= _ring.size())
+      next = _seq - _ring.size() + 1;
+    r = _ring[next % _ring.size()];
+  }
+  pthread_mutex_unlock(&_lock);
+  return v;
+}
+
+unsigned TimingMonitor::history(uint64_t seq, std::vector<TimingRates>& v) const
+{
+  v.clear();
+  pthread_mutex_lock(&_lock);
+  uint64_t first = _seq >= _ring.size() ? _seq - _ring.size() + 1 : 1;
+  if (first <= seq)
+    first = seq+1;
+  for(uint64_t i=first; i<=_seq; i++)
+    v.push_back(_ring[i % _ring.size()]);
+  pthread_mutex_unlock(&_lock);
+  return v.size();
+}
 
-static int row_, column_;
 
 GthEyeScan::GthEyeScan(Path root) :
-  _root(root->findByName("GthEyeScan"))
+  _root       (root->findByName("GthEyeScan")),
+  _run        (IScalVal   ::create(_root->findByName("Run"))),
+  _prescale   (IScalVal   ::create(_root->findByName("Prescale"))),
+  _horzOffset (IScalVal   ::create(_root->findByName("HorzOffset"))),
+  _vertOffset (IScalVal   ::create(_root->findByName("VertOffset"))),
+  _scanDone   (IScalVal_RO::create(_root->findByName("ScanDone"))),
+  _scanState  (IScalVal_RO::create(_root->findByName("ScanState"))),
+  _errorCount (IScalVal_RO::create(_root->findByName("ErrorCount"))),
+  _sampleCount(IScalVal_RO::create(_root->findByName("SampleCount"))),
+  _row        (0),
+  _column     (0),
+  _f          (0),
+  _phase      (Idle)
 {
 }
 
@@ -291,26 +519,21 @@ void GthEyeScan::enable(bool v)
   IScalVal::create(_root->findByName("Enable"))->setVal(&u);
 }
 
-void GthEyeScan::scan(const char* ofile, 
-                      unsigned    prescale, 
-                      unsigned    xscale,
-                      bool        lsparse)
+void GthEyeScan::_setup(unsigned prescale)
 {
-  FILE* f = fopen(ofile,"w");
-
   unsigned status;
   unsigned zero(0), one(1);
-  IScalVal_RO::create(_root->findByName("ScanState"))->getVal(&status);
+  _scanState->getVal(&status);
   printf("eyescan status: %04x\n",status);
   if (status != 0) {
     printf("Forcing to WAIT state\n");
-    IScalVal::create(_root->findByName("Run"))->setVal(&zero);
+    _run->setVal(&zero);
   }
   while(1) {
     sleep(1);
     unsigned vdone, vstate;
-    IScalVal_RO::create(_root->findByName("ScanDone" ))->getVal(&vdone);
-    IScalVal_RO::create(_root->findByName("ScanState"))->getVal(&vstate);
+    _scanDone ->getVal(&vdone);
+    _scanState->getVal(&vstate);
     printf("ScanState/Done = %u.%u\n",vstate,vdone);
     if (vdone==1 && vstate==0)
       break;
@@ -318,7 +541,7 @@ void GthEyeScan::scan(const char* ofile,
   printf("WAIT state\n");
 
   IScalVal::create(_root->findByName("ErrDetEn"))->setVal(&one);
-  IScalVal::create(_root->findByName("Prescale"))->setVal(&prescale);
+  _prescale->setVal(&prescale);
 
   IScalVal_RO::create(_root->findByName("ErrDetEn"))->getVal(&status);
   printf("ErrDet %u\n",status);
@@ -353,13 +576,26 @@ void GthEyeScan::scan(const char* ofile,
   IScalVal::create(_root->findByName("EsVsUtSign"))->setVal(&zero);
   IScalVal::create(_root->findByName("EsVsNegDir"))->setVal(&zero);
 
-  ScalVal horzOffset = IScalVal::create(_root->findByName("HorzOffset"));
-  horzOffset->setVal(&zero);
+  _horzOffset->setVal(&zero);
+}
+
+void GthEyeScan::scan(const char* ofile, 
+                      unsigned    prescale, 
+                      unsigned    xscale,
+                      bool        lsparse)
+{
+  FILE* f = fopen(ofile,"w");
+
+  unsigned status;
+  unsigned zero(0);
+  _setup(prescale);
+
+  ScalVal horzOffset = _horzOffset;
 
   char stime[200];
 
   for(int j=-31; j<32; j++) {
-    row_ = j;
+    _row = j;
 
     time_t t = time(NULL);
     struct tm* tmp = localtime(&t);
@@ -371,13 +607,13 @@ void GthEyeScan::scan(const char* ofile,
     horzOffset->getVal(&status);
     printf("es_horz_offset: %i [%s] (%x)\n",j, stime, status);
 
-    ScalVal code = IScalVal::create(_root->findByName("VertOffset"));
+    ScalVal code = _vertOffset;
     code->setVal(&zero); // zero vert offset
 
     unsigned error_count=-1, error_count_p=-1;
 
     for(int i=-1; i>=-127; i--) {
-      column_ = i;
+      _column = i;
       code->setVal((unsigned*)&i); // vert offset
       unsigned sample_count;
       run(error_count,sample_count);
@@ -389,7 +625,7 @@ void GthEyeScan::scan(const char* ofile,
               sample_count64);
                 
       // -> wait
-      IScalVal::create(_root->findByName("Run"))->setVal(&zero);
+      _run->setVal(&zero);
 
       if (error_count==0 && error_count_p==0 && !lsparse) {
         //          printf("\t%i\n",i);
@@ -404,7 +640,7 @@ void GthEyeScan::scan(const char* ofile,
     code->setVal(&zero); // zero vert offset
     error_count_p = -1;
     for(int i=127; i>=0; i--) {
-      column_ = i;
+      _column = i;
       code->setVal((unsigned*)&i); // vert offset
       unsigned sample_count;
       run(error_count,sample_count);
@@ -416,7 +652,7 @@ void GthEyeScan::scan(const char* ofile,
               sample_count64);
                 
       // -> wait
-      IScalVal::create(_root->findByName("Run"))->setVal(&zero);
+      _run->setVal(&zero);
 
       if (error_count==0 && error_count_p==0 && !lsparse) {
         //          printf("\t%i\n",i);
@@ -434,14 +670,167 @@ void GthEyeScan::scan(const char* ofile,
   fclose(f);
 }
 
+//
+//  Vertical offset codes are sign/magnitude in bits 7:0 with the UT sign
+//  in bit 8, as written by scan(): -1..-127 are magnitudes 127..1 below,
+//  0..127 above.  The eye is open (no errors) inside a boundary magnitude
+//  on each side, and shut beyond it.
+//
+static int _code(int sign, int mag) { return sign<0 ? mag-128 : mag; }
+
+void GthEyeScan::_begin(int vert)
+{
+  unsigned one(1);
+  _column = vert;
+  _vertOffset->setVal((unsigned*)&vert);
+  _run->setVal(&one);
+  _nwait = 0;
+  _npoints++;
+}
+
+unsigned GthEyeScan::_end()
+{
+  unsigned zero(0);
+  unsigned error_count, sample_count;
+  _errorCount ->getVal(&error_count);
+  _sampleCount->getVal(&sample_count);
+  uint64_t sample_count64 = uint64_t(sample_count) << (1 + _curPre);
+  fprintf(_f, "%d %d %u %llu\n",
+          _row, _column,
+          error_count,
+          (unsigned long long)sample_count64);
+  // -> wait
+  _run->setVal(&zero);
+  return error_count;
+}
+
+bool GthEyeScan::start(const char* ofile,
+                       unsigned    prescale,
+                       unsigned    maxPrescale,
+                       unsigned    xscale)
+{
+  _f = fopen(ofile,"w");
+  if (!_f) {
+    perror(ofile);
+    return false;
+  }
+
+  _setup(prescale);
+
+  _pre     = prescale;
+  _maxPre  = maxPrescale;
+  _curPre  = prescale;
+  _xscale  = xscale;
+  _npoints = 0;
+  _row     = -32;
+  _sign    = 1;
+  _side();
+  return true;
+}
+
+//  Starts bisection on the next side of the eye
+void GthEyeScan::_side()
+{
+  if (_sign > 0) {
+    if (++_row == 32) {
+      printf("%u points\n", _npoints);
+      fclose(_f);
+      _f = 0;
+      _phase = Idle;
+      return;
+    }
+    unsigned hoff = _row<<_xscale;
+    _horzOffset->setVal(&hoff);
+    _sign = -1;
+  }
+  else
+    _sign = 1;
+
+  //  open at magnitude lo, shut at hi (virtual outside [1,127] / [0,127])
+  _lo    = _sign<0 ? 0 : -1;
+  _hi    = 128;
+  _phase = Bisect;
+  _begin(_code(_sign,(_lo+_hi)/2));
+}
+
+void GthEyeScan::_next(unsigned error_count)
+{
+  int inner = _sign<0 ? 1 : 0;
+  if (_phase == Bisect) {
+    int mid = (_lo+_hi)/2;
+    if (error_count)
+      _hi = mid;
+    else
+      _lo = mid;
+    if (_hi-_lo > 1) {
+      _begin(_code(_sign,(_lo+_hi)/2));
+      return;
+    }
+    _phase = Refine;
+  }
+  else if (error_count) {
+    //  More samples found errors just inside the boundary
+    _hi = _lo--;
+    if (_lo >= inner) {
+      _begin(_code(_sign,_lo));
+      return;
+    }
+  }
+
+  //  The boundary is clean at this prescale; try the next
+  if (_curPre < _maxPre && _lo >= inner) {
+    _curPre++;
+    _prescale->setVal(&_curPre);
+    _begin(_code(_sign,_lo));
+    return;
+  }
+
+  if (_curPre != _pre) {
+    _curPre = _pre;
+    _prescale->setVal(&_curPre);
+  }
+  printf("horz %d %s: boundary %d\n", _row, _sign<0 ? "below":"above", _lo);
+  _side();
+}
+
+bool GthEyeScan::poll()
+{
+  if (_phase == Idle)
+    return false;
+
+  unsigned vdone;
+  _scanDone->getVal(&vdone);
+  if (vdone==0 && ++_nwait < 1000)
+    return true;
+
+  unsigned vstate;
+  _scanState->getVal(&vstate);
+  if (vstate!=2)
+    return true;
+
+  _next(_end());
+  return _phase != Idle;
+}
+
+void GthEyeScan::adaptive(const char* ofile,
+                          unsigned    prescale,
+                          unsigned    maxPrescale,
+                          unsigned    xscale)
+{
+  if (!start(ofile, prescale, maxPrescale, xscale))
+    return;
+  while(poll())
+    usleep(100);
+}
+
 void GthEyeScan::run(unsigned& error_count,
                      unsigned& sample_count)
 {
-  unsigned zero(0), one(1);
+  unsigned one(1);
 
   // -> wait
-  IScalVal::create(_root->findByName("Run"))->setVal(&one);
-  ScalVal_RO done = IScalVal_RO::create(_root->findByName("ScanDone"));
+  _run->setVal(&one);
+  ScalVal_RO done = _scanDone;
   unsigned vdone;
   unsigned nwait=0;
   while(1) {
@@ -451,19 +840,54 @@ void GthEyeScan::run(unsigned& error_count,
       done->getVal(&vdone);
     } while(vdone==0 and nwait < 1000);
     unsigned vstate;
-    IScalVal_RO::create(_root->findByName("ScanState"))->getVal(&vstate);
+    _scanState->getVal(&vstate);
     if (vstate==2)
       break;
   }
-  IScalVal_RO::create(_root->findByName("ErrorCount"))->getVal(&error_count);
-  IScalVal_RO::create(_root->findByName("SampleCount"))->getVal(&sample_count);
+  _errorCount ->getVal(&error_count);
+  _sampleCount->getVal(&sample_count);
 }            
 
 void GthEyeScan::progress(unsigned& row,
-                          unsigned& col)
+                          unsigned& col) const
 {
-  row = row_;
-  col = column_;
+  row = _row;
+  col = _column;
+}
+
+void EyeScanScheduler::add(GthEyeScan* scan,
+                           const char* ofile,
+                           unsigned    prescale,
+                           unsigned    maxPrescale,
+                           unsigned    xscale)
+{
+  Lane lane;
+  lane.scan        = scan;
+  lane.ofile       = ofile;
+  lane.prescale    = prescale;
+  lane.maxPrescale = maxPrescale;
+  lane.xscale      = xscale;
+  _lanes.push_back(lane);
+}
+
+void EyeScanScheduler::run()
+{
+  std::vector<GthEyeScan*> active;
+  for(unsigned i=0; i<_lanes.size(); i++) {
+    const Lane& l = _lanes[i];
+    if (l.scan->start(l.ofile, l.prescale, l.maxPrescale, l.xscale))
+      active.push_back(l.scan);
+  }
+
+  while(!active.empty()) {
+    for(unsigned i=0; i<active.size(); ) {
+      if (active[i]->poll())
+        i++;
+      else
+        active.erase(active.begin()+i);
+    }
+    usleep(100);
+  }
 }
 
 IpAddrFixup::~IpAddrFixup() {}
@@ -14,11 +14,16 @@
 #include <unistd.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
 
 #include <string>
+#include <vector>
 
 #include <cpsw_api_user.h>
 
+#include "hps_regmap.hh"
+
 namespace Cphw {
 
   class AxiVersion {
@@ -42,17 +47,36 @@ namespace Cphw {
     Path _root;
   };
 
+  //
+  //  Capture buffer readout.  The capture is fetched with ranged reads of
+  //  up to CHUNK words into a buffer kept across captures, then decoded
+  //  in a separate pass.
+  //
   class RingBuffer {
   public:
+    enum { MAXLEN = 0x3ff, CHUNK = 256 };
     RingBuffer(Path);
+    virtual ~RingBuffer();
   public:
     void     enable (bool);
     void     clear  ();
     void     dump   ();
     void     clear_and_dump(unsigned wait_us = 100);
+  public:
+    //  Captured words, from csr
+    virtual unsigned length() const;
+    //  Fetch len words; valid until the next read
+    const uint32_t*  read  (unsigned len);
+    virtual void     decode(FILE*, const uint32_t*, unsigned len) const;
+    //  Re-arm, capture for wait_us and append to f, n times (0: until
+    //  *run is cleared).  Each capture is written as its length word
+    //  followed by the words.  Returns the number of captures.
+    unsigned stream (FILE* f, unsigned wait_us, unsigned n=0,
+                     volatile bool* run=0);
   protected:
     ScalVal _csr;
     ScalVal _dump;
+    std::vector<uint32_t> _buff;
   };
 
   class TimingStats {
@@ -67,6 +91,9 @@ namespace Cphw {
     unsigned dec;
   };
 
+  //
+  //  TimingFrameRx handles are resolved once, at construction
+  //
   class AmcTiming {
   public:
     AmcTiming(Path);
@@ -87,10 +114,73 @@ namespace Cphw {
     XBar       xbar   () { return XBar(_root->findByName("AxiSy56040")); }
     RingBuffer ring0  () { return RingBuffer(_root->findByName("ring0")); }
     RingBuffer ring1  () { return RingBuffer(_root->findByName("ring1")); }
+  private:
+    unsigned _get(const RegDesc&) const;
+    void     _set(const RegDesc&, unsigned);
   public:
     Path _root;
     Path _timingRx;
     Path _alignRx;
+  private:
+    mutable RegBlock _frameRx;
+  };
+
+  //  Rates over one monitor period
+  class TimingRates {
+  public:
+    uint64_t seq;
+    timespec time;      // CLOCK_REALTIME at the end of the period
+    double   dt;        // seconds
+    unsigned linkup;
+    unsigned polarity;
+    double   sof;       // per second
+    double   crc;
+    double   dec;
+    double   dsp;
+    double   rxClkMHz;
+    double   txClkMHz;
+  };
+
+  //
+  //  Samples the TimingFrameRx counters every period from a thread of its
+  //  own and keeps the rates of the last depth periods.  Counter deltas
+  //  are taken modulo 2^32, so wraps between samples are harmless.  Any
+  //  number of clients may follow the samples, each with its own cursor
+  //  (the seq of the last sample it saw).
+  //
+  class TimingMonitor {
+  public:
+    TimingMonitor(const AmcTiming&, unsigned periodMs=1000, unsigned depth=64);
+    ~TimingMonitor();
+  public:
+    int      start  ();
+    void     stop   ();
+    //  Take one sample now; false for the first (no rates yet)
+    bool     sample ();
+  public:
+    //  Newest sample; false if there is none yet
+    bool     latest (TimingRates&) const;
+    //  Waits for a sample newer than seq; false on timeout (ms, <0: forever)
+    bool     wait   (uint64_t seq, TimingRates&, int timeoutMs=-1) const;
+    //  Samples newer than seq still held, oldest first
+    unsigned history(uint64_t seq, std::vector<TimingRates>&) const;
+  private:
+    static void* _run(void*);
+  private:
+    TimingMonitor(const TimingMonitor&);
+    TimingMonitor& operator=(const TimingMonitor&);
+  private:
+    const AmcTiming&         _timing;
+    unsigned                 _periodMs;
+    std::vector<TimingRates> _ring;
+    uint64_t                 _seq;      // samples taken
+    TimingStats              _last;
+    timespec                 _lastTime; // CLOCK_MONOTONIC
+    bool                     _primed;
+    mutable pthread_mutex_t  _lock;
+    mutable pthread_cond_t   _cond;
+    pthread_t                _thread;
+    volatile bool            _running;
   };
 
   class GthEyeScan {
@@ -102,12 +192,77 @@ namespace Cphw {
                  unsigned    prescale=0,
                  unsigned    xscale=0,
                  bool        lsparse=false);
+    //  Finds the eye contour by bisecting the vertical offset at each
+    //  horizontal offset, then re-measures around the boundary with the
+    //  prescale raised up to maxPrescale.  Same output format as scan().
+    void adaptive(const char* ofile,
+                  unsigned    prescale=0,
+                  unsigned    maxPrescale=0,
+                  unsigned    xscale=0);
     void run    (unsigned&   error_count,
                  unsigned&   sample_count);
-    static void progress(unsigned& row,
-                         unsigned& col);
+    void progress(unsigned& row,
+                  unsigned& col) const;
+  public:
+    //  The adaptive scan one step at a time, for EyeScanScheduler:
+    //  start() sets up and starts the first point, poll() returns false
+    //  once the scan is complete and otherwise never waits
+    bool start  (const char* ofile,
+                 unsigned    prescale=0,
+                 unsigned    maxPrescale=0,
+                 unsigned    xscale=0);
+    bool poll   ();
+  private:
+    void     _setup(unsigned prescale);
+    void     _begin(int vert);
+    unsigned _end  ();
+    void     _next (unsigned error_count);
+    void     _side ();
   public:
     Path _root;
+  private:
+    ScalVal    _run;
+    ScalVal    _prescale;
+    ScalVal    _horzOffset;
+    ScalVal    _vertOffset;
+    ScalVal_RO _scanDone;
+    ScalVal_RO _scanState;
+    ScalVal_RO _errorCount;
+    ScalVal_RO _sampleCount;
+    //  Progress
+    volatile int _row;
+    volatile int _column;
+    //  Adaptive scan state
+    enum Phase { Idle, Bisect, Refine };
+    FILE*      _f;
+    Phase      _phase;
+    unsigned   _pre, _maxPre, _curPre, _xscale;
+    int        _sign, _lo, _hi;
+    unsigned   _nwait;
+    unsigned   _npoints;
+  };
+
+  //
+  //  Runs adaptive scans on several lanes at once from one thread.  Each
+  //  lane's point runs in the hardware while the others are read out and
+  //  restarted.
+  //
+  class EyeScanScheduler {
+  public:
+    void add(GthEyeScan*,
+             const char* ofile,
+             unsigned    prescale=0,
+             unsigned    maxPrescale=0,
+             unsigned    xscale=0);
+    void run();
+  private:
+    class Lane {
+    public:
+      GthEyeScan* scan;
+      const char* ofile;
+      unsigned    prescale, maxPrescale, xscale;
+    };
+    std::vector<Lane> _lanes;
   };
 
   class IpAddrFixup : public IYamlFixup {
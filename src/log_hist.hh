@@ -0,0 +1,45 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef Cphw_LogHist_hh
+#define Cphw_LogHist_hh
+
+//
+//  Latency histogram with power-of-two bins: [0] < 1us, [i] < 2^i us,
+//  [nbins-1] everything longer.  The counts live with their owner (e.g.
+//  in a shared-memory page), so only the binning is kept here.
+//
+#include <stdint.h>
+
+namespace Cphw {
+  class LogHist {
+  public:
+    static unsigned bin(uint64_t ns, unsigned nbins)
+    {
+      uint64_t us = ns/1000;
+      unsigned b  = us ? 64-__builtin_clzll(us) : 0;
+      return b < nbins-1 ? b : nbins-1;
+    }
+    //  Upper edge of the bin holding fraction f of count; maxNs past the
+    //  last bin
+    static double percentileUs(const uint64_t* hist, unsigned nbins,
+                               uint64_t count, uint64_t maxNs, double f)
+    {
+      uint64_t n = 0, nf = uint64_t(f*double(count));
+      for(unsigned i=0; i<nbins; i++) {
+        n += hist[i];
+        if (n > nf)
+          return double(1U<<i);
+      }
+      return 1.e-3*double(maxNs);
+    }
+  };
+};
+
+#endif
@@ -35,6 +35,8 @@
 #include "sequence_engine.hh"
 #include "user_sequence.hh"
 #include "event_selection.hh"
+#include "rate_counters.hh"
+#include "yaml_cache.hh"
 
 static unsigned _charge = 0xabcd;
 
@@ -145,7 +147,7 @@ int main(int argc, char* argv[])
 
   TPGen::TPG* p;
   if (yaml) {
-    Path path = IPath::loadYamlFile(yaml,"NetIODev");
+    Path path = Cphw::YamlCache::load(yaml,"NetIODev");
     p = new TPGen::TPGYaml(path);
 
     { char buff[256];
@@ -219,10 +221,10 @@ int main(int argc, char* argv[])
   pthread_create(&rthread, &attr, &recover_thread, args);
 
   //  { FixedRateSelect evt(0,0x1);  // all beam requests for destn 0
-  for(unsigned i=0; i<16; i++) {
-    FixedRateSelect evt(0,(1<<i));
-    p->setCounter(i, &evt);
-  }
+  RateCounters counters(*static_cast<TPGYaml*>(p));
+  for(unsigned i=0; i<16; i++)
+    counters.add(FixedRateSelect(0,(1<<i)));
+  counters.configure();
 
   while(1) {
     sleep(1);
@@ -232,9 +234,10 @@ int main(int argc, char* argv[])
       p->getMpsState(i,latch,state);
       printf("   %02u [%02u]",latch,state);
     }
+    counters.update();
     printf("\n%17.17s","Beam Rates:");
     for(unsigned i=0; i<16; i++)
-      printf(" %9.9u", p->getCounter(i));
+      printf(" %9.9u", counters.count(i));
     printf("\n");
   }
 
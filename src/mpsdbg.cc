@@ -21,6 +21,7 @@
 #include <cpsw_yaml.h>
 
 #include "hps_utils.hh"
+#include "yaml_cache.hh"
 
 using namespace Cphw;
 
@@ -28,37 +29,23 @@ class MpsDbgRingBuffer : public Cphw::RingBuffer {
 public:
   MpsDbgRingBuffer(Path p) : Cphw::RingBuffer(p) {}
 public:
-  void     dump   () {
-    unsigned len;
-    _csr->getVal(&len);
-    unsigned wid = (len>>20)&0xff;
-    len &= (1<<wid)-1;
-    len = 0x3ff;
-    printf("[wid=%x,len=%x]\n",wid,len);
-    //  firmware only captures to a max length of 0x3ff words
-    if (len>0x3ff) len=0x3ff;
-    uint32_t* buff = new uint32_t[len];
+  //  The capture length in csr is not maintained
+  unsigned length() const { return MAXLEN; }
+  void     decode(FILE* f, const uint32_t* buff, unsigned len) const {
     char bstr[256];
 
-    printf("timestmp  tag latch  beamclass\n");
-    
-    for(unsigned i=0; i<len; i++) {
-      IndexRange range(i);
-      _dump->getVal(&buff[i],1,&range);
-      if ((i&3)==3) {
-        unsigned index = i&~3;
-        sprintf(bstr,"%08x:%08x:%08x",buff[index],buff[index+1],buff[index+2]);
-        _dumpline(bstr,buff,index);
-
-        _dumpline(bstr,buff,index+1);
-        _dumpline(bstr,buff,index+2);
-        printf("%s\n",bstr);
-      }
-    }
+    fprintf(f,"timestmp  tag latch  beamclass\n");
 
-    delete[] buff;
+    for(unsigned index=0; index+3<len; index+=4) {
+      sprintf(bstr,"%08x:%08x:%08x",buff[index],buff[index+1],buff[index+2]);
+      _dumpline(bstr,buff,index);
+
+      _dumpline(bstr,buff,index+1);
+      _dumpline(bstr,buff,index+2);
+      fprintf(f,"%s\n",bstr);
+    }
   }
-  void _dumpline(char* s, uint32_t* buff, unsigned index) {
+  void _dumpline(char* s, const uint32_t* buff, unsigned index) const {
     unsigned latch = (buff[index]>>1)&1;
     unsigned tag   = (buff[index]>>2)&0xffff;
     unsigned tstamp = (buff[index]>>18)&0x3fff;
@@ -189,7 +176,7 @@ int main(int argc, char* argv[])
   printf("fixup started\n");
 
   IYamlFixup* fixup = new IpAddrFixup(ip);
-  Path path = IPath::loadYamlFile(yaml_file,"NetIODev",0,fixup);
+  Path path = YamlCache::load(yaml_file,"NetIODev",fixup,yaml_path);
   delete fixup;
 
   printf("fixup complete\n");
@@ -32,12 +32,20 @@ static bool verbose = false;
 
 class MpsSim {
 public:
-  unsigned latchDiag() const { return unsigned(_csr)&1; }
-  unsigned tag      () const { return unsigned(_tag_ts)&0xffff; }
-  unsigned timestamp() const { return (unsigned(_tag_ts)>>16)&0xffff; }
+  unsigned latchDiag() const { return latchDiag(unsigned(_csr)); }
+  unsigned tag      () const { return tag      (unsigned(_tag_ts)); }
+  unsigned timestamp() const { return timestamp(unsigned(_tag_ts)); }
   unsigned pclass   (unsigned i) const
   { 
-    return (unsigned(_pclass[i/4])>>(8*(i&3)))&0xf; 
+    return pclass(unsigned(_pclass[i/4]), i); 
+  }
+  //  Decode the words read by snapshot(); pcw is the word holding class i
+  static unsigned latchDiag(uint32_t csr)    { return csr&1; }
+  static unsigned tag      (uint32_t tag_ts) { return tag_ts&0xffff; }
+  static unsigned timestamp(uint32_t tag_ts) { return (tag_ts>>16)&0xffff; }
+  static unsigned pclass   (uint32_t pcw, unsigned i)
+  {
+    return (pcw>>(8*(i&3)))&0xf;
   }
   void setLatch(bool v) 
   { 
@@ -98,6 +106,15 @@ public:
     }
     return 0;
   }
+  //  Status registers in one window of requests
+  int snapshot(uint32_t& csr, uint32_t& tag_ts, uint32_t* pclass) const
+  {
+    _csr   .fetch(csr);
+    _tag_ts.fetch(tag_ts);
+    for(unsigned i=0; i<4; i++)  // as pclass(0..15)
+      _pclass[i].fetch(pclass[i]);
+    return Pds::Cphw::Reg::flush();
+  }
   void dump() {
     printf("csr: %08x\n",unsigned(_csr));
     printf("tag: %08x\n",unsigned(_tag_ts));
@@ -166,7 +183,8 @@ int main(int argc, char** argv) {
   if (verbose)
     printf("port %d dst %d pc %d\n",port,dst,pc);
 
-  Pds::Cphw::Reg::set(ip, 8192, 0);
+  if (Pds::Cphw::Reg::set(ip, 8192, 0) < 0)
+    return 1;
 
   MpsSim* p = new ((void*)0x82000000) MpsSim;
 
@@ -225,21 +243,20 @@ int main(int argc, char** argv) {
   else {
     p->process(dst,pc,latch_tag);
 
-    unsigned latch, tag, timestamp;
-    unsigned pclass[16];
-    
-    latch     = p->latchDiag();
-    tag       = p->tag();
-    timestamp = p->timestamp();
-
-    for(unsigned i=0; i<16; i++)
-      pclass[i] = p->pclass(i);
-
-    printf("Latch [%u]  Tag [%x]  Timestamp[%x]\n",
-           latch, tag, timestamp );
-    for(unsigned i=0; i<16; i++)
-      printf("  c%u[%x]", i, pclass[i]);
-    printf("\n");
+    uint32_t csr = 0, tag_ts = 0, pcw[4] = {0,0,0,0};
+    if (p->snapshot(csr, tag_ts, pcw) < 0) {
+      Pds::Cphw::Reg::Stats s;
+      Pds::Cphw::Reg::stats(s);
+      printf("MpsSim: register read failed (%llu retries, %llu timeouts)\n",
+             (unsigned long long)s.retries, (unsigned long long)s.timeouts);
+    }
+    else {
+      printf("Latch [%u]  Tag [%x]  Timestamp[%x]\n",
+             MpsSim::latchDiag(csr), MpsSim::tag(tag_ts), MpsSim::timestamp(tag_ts));
+      for(unsigned i=0; i<16; i++)
+        printf("  c%u[%x]", i, MpsSim::pclass(pcw[i/4], i));
+      printf("\n");
+    }
     p->dump();
   }
 
@@ -0,0 +1,134 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "rate_counters.hh"
+#include "tpg_yaml.hh"
+#include "event_selection.hh"
+
+//  CountIntv is in units of the 186M clock
+static const double CLK_FREQ = 1300e6/7.;
+
+using namespace TPGen;
+
+RateCounters::RateCounters(TPGYaml& tpg) :
+  _tpg     (tpg),
+  _bank    (tpg.nRateCounters()),
+  _group   (0),
+  _settling(true),
+  _interval(0)
+{
+}
+
+RateCounters::~RateCounters()
+{
+}
+
+unsigned RateCounters::add(const EventSelection& s)
+{
+  return add(s.word());
+}
+
+unsigned RateCounters::add(uint32_t word)
+{
+  _words  .push_back(word);
+  _counts .push_back(0);
+  _rates  .push_back(0);
+  _updated.push_back(0);
+  return _words.size()-1;
+}
+
+void RateCounters::set(unsigned index, const EventSelection& s)
+{
+  if (index < _words.size()) {
+    _words  [index] = s.word();
+    _updated[index] = 0;
+    if (index/_bank == _group)
+      _load(_group);
+  }
+}
+
+void RateCounters::clear()
+{
+  _words  .clear();
+  _counts .clear();
+  _rates  .clear();
+  _updated.clear();
+  _group = 0;
+}
+
+unsigned RateCounters::nGroups() const
+{
+  return (_words.size()+_bank-1)/_bank;
+}
+
+void RateCounters::configure()
+{
+  _load(0);
+}
+
+void RateCounters::update()
+{
+  std::vector<uint32_t> counts(_bank);
+  _tpg.getCounters(counts.data(), _bank);
+  _update(counts.data(), _tpg.getCountInterval());
+}
+
+void RateCounters::update(const TPGIntervalCounters& c)
+{
+  _update(c.rateCounters, c.countInterval);
+}
+
+double RateCounters::rate(unsigned index) const
+{
+  return index < _rates.size() ? _rates[index] : 0;
+}
+
+uint32_t RateCounters::count(unsigned index) const
+{
+  return index < _counts.size() ? _counts[index] : 0;
+}
+
+unsigned RateCounters::updated(unsigned index) const
+{
+  return index < _updated.size() ? _updated[index] : 0;
+}
+
+void RateCounters::_update(const uint32_t* counts, unsigned countInterval)
+{
+  _interval++;
+  if (_words.empty())
+    return;
+
+  //  The first interval after a reload counted partly with the old
+  //  definitions; discard it
+  if (_settling)
+    _settling = false;
+  else {
+    unsigned i0 = _group*_bank;
+    for(unsigned i=0; i<_bank && i0+i<_words.size(); i++) {
+      _counts [i0+i] = counts[i];
+      _rates  [i0+i] = countInterval ? double(counts[i])*CLK_FREQ/double(countInterval) : 0;
+      _updated[i0+i] = _interval;
+    }
+    //  Multiplexing: move to the next group
+    if (nGroups() > 1)
+      _load((_group+1)%nGroups());
+  }
+}
+
+void RateCounters::_load(unsigned group)
+{
+  std::vector<uint32_t> words(_bank,0);
+  unsigned i0 = group*_bank;
+  for(unsigned i=0; i<_bank && i0+i<_words.size(); i++)
+    words[i] = _words[i0+i];
+  _tpg.setCounters(words.data(), _bank);
+  _group    = group;
+  _settling = true;
+}
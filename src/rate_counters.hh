@@ -0,0 +1,70 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef TPGEN_RATECOUNTERS_HH
+#define TPGEN_RATECOUNTERS_HH
+
+//
+//  Manager for the programmable rate counters.
+//  Logical counters are defined by event selection words.  Up to
+//  nRateCounters() of them are loaded into the hardware bank at a time;
+//  with more, the bank is rotated through groups of logical counters,
+//  one group per count interval.
+//
+#include <stdint.h>
+
+#include <vector>
+
+namespace TPGen {
+  class TPGYaml;
+  class EventSelection;
+  class TPGIntervalCounters;
+
+  class RateCounters {
+  public:
+    RateCounters(TPGYaml&);
+    ~RateCounters();
+  public:
+    //  Define a logical counter; returns its index
+    unsigned add    (const EventSelection&);
+    unsigned add    (uint32_t word);
+    void     set    (unsigned index, const EventSelection&);
+    void     clear  ();
+    unsigned size   () const { return _words.size(); }
+    unsigned nGroups() const;
+  public:
+    //  Load the first group of definitions in one ranged write
+    void     configure();
+    //  Call once per count interval, reading the bank from hardware
+    void     update   ();
+    //  ..or from an interval capture (TPGYaml::enableIntervalCapture)
+    void     update   (const TPGIntervalCounters&);
+  public:
+    //  Rate [Hz] and raw count from the latest valid interval
+    double   rate     (unsigned index) const;
+    uint32_t count    (unsigned index) const;
+    //  Interval number of the latest valid reading (0 = none yet)
+    unsigned updated  (unsigned index) const;
+  private:
+    void     _update  (const uint32_t* counts, unsigned countInterval);
+    void     _load    (unsigned group);
+  private:
+    TPGYaml&              _tpg;
+    unsigned              _bank;      // hardware counters
+    std::vector<uint32_t> _words;     // definitions
+    std::vector<uint32_t> _counts;
+    std::vector<double>   _rates;
+    std::vector<unsigned> _updated;
+    unsigned              _group;     // group currently loaded
+    bool                  _settling;  // definitions changed during this interval
+    unsigned              _interval;
+  };
+};
+
+#endif
@@ -0,0 +1,132 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+//
+//  Stand-in for the FPGA register target of Reg.cc based tools
+//  (tpr_scan, mpssim_tst), e.g.
+//
+//    reg_emu -f mpssim.regs -l 1,1 -d 50,500 &
+//    mpssim_tst -a 127.0.0.1 -C 3,2
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+
+#include "RegEmulator.hh"
+
+using Pds::Cphw::RegEmulator;
+
+static RegEmulator* emu;
+
+static void sigHandler(int)
+{
+  emu->stop();
+}
+
+static void usage(const char* p) {
+  printf("Usage: %s [options]\n",p);
+  printf("Options: -a <IP addr>        : bind to <IP> (default 127.0.0.1)\n");
+  printf("         -p <port>           : UDP port (default 8192)\n");
+  printf("         -f <filename>       : load registers and behaviours\n");
+  printf("         -o <filename>       : save registers on exit\n");
+  printf("         -l <req%%,rsp%%>      : drop requests/responses\n");
+  printf("         -d <min,max>        : delay responses [us]\n");
+  printf("         -D <pct>            : duplicate responses\n");
+  printf("         -s <seed>           : random seed\n");
+  printf("Register file lines: <addr> <value> [counter <n>|clear <mask>|strobe <mask>|ro]\n");
+}
+
+int main(int argc, char** argv) {
+
+  const char* ip    = "127.0.0.1";
+  unsigned    port  = 8192;
+  const char* fin   = 0;
+  const char* fout  = 0;
+  double      lossReq = 0, lossRsp = 0, dup = 0;
+  unsigned    minUs = 0, maxUs = 0;
+  unsigned    seed  = 1;
+  char*       endptr;
+
+  int c;
+  while( (c=getopt(argc,argv,"a:p:f:o:l:d:D:s:h"))!=-1 ) {
+    switch(c) {
+    case 'a':
+      ip = optarg;
+      break;
+    case 'p':
+      port = strtoul(optarg,NULL,0);
+      break;
+    case 'f':
+      fin = optarg;
+      break;
+    case 'o':
+      fout = optarg;
+      break;
+    case 'l':
+      lossReq = strtod(optarg,&endptr)*0.01;
+      lossRsp = *endptr==',' ? strtod(endptr+1,NULL)*0.01 : lossReq;
+      break;
+    case 'd':
+      minUs = strtoul(optarg,&endptr,0);
+      maxUs = *endptr==',' ? strtoul(endptr+1,NULL,0) : minUs;
+      break;
+    case 'D':
+      dup = strtod(optarg,NULL)*0.01;
+      break;
+    case 's':
+      seed = strtoul(optarg,NULL,0);
+      break;
+    default:
+      usage(argv[0]); return 1;
+    }
+  }
+
+  emu = new RegEmulator(port, ip);
+  if (emu->status() < 0)
+    return 1;
+
+  if (fin && emu->load(fin) < 0)
+    return 1;
+
+  emu->loss     (lossReq, lossRsp);
+  emu->latency  (minUs, maxUs);
+  emu->duplicate(dup);
+  emu->seed     (seed);
+
+  ::signal( SIGINT , sigHandler );
+  ::signal( SIGTERM, sigHandler );
+
+  printf("Serving %s:%u\n", ip, emu->port());
+  emu->serve(-1);
+
+  RegEmulator::Stats s;
+  emu->stats(s);
+  printf("%llu requests, %llu words read, %llu written, %llu dropped, %llu delayed, %llu duplicated, %llu errors\n",
+         (unsigned long long)s.requests,
+         (unsigned long long)s.reads,
+         (unsigned long long)s.writes,
+         (unsigned long long)s.dropped,
+         (unsigned long long)s.delayed,
+         (unsigned long long)s.duplicated,
+         (unsigned long long)s.errors);
+
+  if (fout) {
+    FILE* f = fopen(fout,"w");
+    if (!f)
+      perror(fout);
+    else {
+      emu->dump(f);
+      fclose(f);
+    }
+  }
+
+  delete emu;
+  return 0;
+}
@@ -0,0 +1,96 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef Cphw_RegMap_hh
+#define Cphw_RegMap_hh
+
+//
+//  Typed register descriptors and a per-block cache of CPSW handles.
+//  Descriptors are generated from the yaml register maps (hps_regmap.hh)
+//  or declared alongside the driver that uses them (tpg_regs.hh), so a
+//  misspelled register is a compile error rather than a runtime lookup
+//  failure.  Registers are still reached through CPSW, whose user API has
+//  no access by offset: the path is looked up once per block, and later
+//  accesses reuse the cached handle.
+//
+#include <stdint.h>
+#include <pthread.h>
+
+#include <vector>
+
+#include <cpsw_api_user.h>
+
+namespace Cphw {
+
+  class RegStats;
+
+  class RegDesc {
+  public:
+    enum Mode { RO, RW, WO };
+  public:
+    unsigned    index;     // slot in the block's handle cache
+    const char* path;      // path relative to the block root
+    unsigned    nelms;
+    Mode        mode;
+  };
+
+  //
+  //  Handles are created on first use and kept for the life of the block,
+  //  so a register missing from older firmware only fails when accessed.
+  //
+  class RegBlock {
+  public:
+    RegBlock(Path root, unsigned nregs) :
+      _root(root), _ro(nregs), _rw(nregs), _stats(0)
+    { pthread_mutex_init(&_lock,0); }
+    ~RegBlock() { pthread_mutex_destroy(&_lock); }
+  public:
+    Path       root() const { return _root; }
+    RegStats*  stats() const { return _stats; }
+    void       stats(RegStats* s) { _stats = s; }
+    Path       path(const RegDesc& r) const { return _root->findByName(r.path); }
+    ScalVal_RO ro  (const RegDesc& r)
+    {
+      pthread_mutex_lock(&_lock);
+      if (!_ro[r.index]) {
+        if (_rw[r.index])
+          _ro[r.index] = _rw[r.index];
+        else {
+          try { _ro[r.index] = IScalVal_RO::create(path(r)); }
+          catch(...) { pthread_mutex_unlock(&_lock); throw; }
+        }
+      }
+      ScalVal_RO v = _ro[r.index];
+      pthread_mutex_unlock(&_lock);
+      return v;
+    }
+    ScalVal    rw  (const RegDesc& r)
+    {
+      pthread_mutex_lock(&_lock);
+      if (!_rw[r.index]) {
+        try { _rw[r.index] = IScalVal::create(path(r)); }
+        catch(...) { pthread_mutex_unlock(&_lock); throw; }
+      }
+      ScalVal v = _rw[r.index];
+      pthread_mutex_unlock(&_lock);
+      return v;
+    }
+  private:
+    RegBlock(const RegBlock&);
+    RegBlock& operator=(const RegBlock&);
+  private:
+    Path                    _root;
+    std::vector<ScalVal_RO> _ro;
+    std::vector<ScalVal>    _rw;
+    RegStats*               _stats;
+    pthread_mutex_t         _lock;
+  };
+};
+
+#endif
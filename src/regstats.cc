@@ -0,0 +1,157 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "regstats.hh"
+#include "log_hist.hh"
+
+#include <string.h>
+#include <time.h>
+
+#include <exception>
+
+using namespace Cphw;
+
+static void _record(RegStats::Entry& e, unsigned bytes, bool write,
+                    uint64_t ns, bool error)
+{
+  e.count++;
+  if (write)
+    e.writes++;
+  e.bytes += bytes;
+  if (error)
+    e.errors++;
+  e.totNs += ns;
+  if (ns > e.maxNs)
+    e.maxNs = ns;
+  e.hist[LogHist::bin(ns, RegStats::NBINS)]++;
+}
+
+static void _dump(FILE* f, const char* title, const RegStats::EntryMap& m)
+{
+  fprintf(f,"%-56.56s %10s %10s %12s %8s %9s %9s %9s %9s\n",
+          title,"count","writes","bytes","errors","avg[us]","p50[us]","p99[us]","max[us]");
+  for(RegStats::EntryMap::const_iterator it=m.begin(); it!=m.end(); it++) {
+    const RegStats::Entry& e = it->second;
+    fprintf(f,"%-56.56s %10llu %10llu %12llu %8llu %9.1f %9.0f %9.0f %9.1f\n",
+            it->first.c_str(),
+            (unsigned long long)e.count,
+            (unsigned long long)e.writes,
+            (unsigned long long)e.bytes,
+            (unsigned long long)e.errors,
+            e.count ? 1.e-3*double(e.totNs)/double(e.count) : 0.,
+            e.percentileUs(0.50),
+            e.percentileUs(0.99),
+            1.e-3*double(e.maxNs));
+    fprintf(f,"%56.56s","hist[us]:");
+    for(unsigned i=0; i<RegStats::NBINS; i++)
+      if (e.hist[i])
+        fprintf(f," <%u:%llu", 1U<<i, (unsigned long long)e.hist[i]);
+    fprintf(f,"\n");
+  }
+}
+
+RegStats::Entry::Entry() :
+  count(0), writes(0), bytes(0), errors(0), totNs(0), maxNs(0)
+{
+  memset(hist,0,sizeof(hist));
+}
+
+double RegStats::Entry::percentileUs(double f) const
+{
+  return LogHist::percentileUs(hist, NBINS, count, maxNs, f);
+}
+
+RegStats::RegStats() : _enabled(false)
+{
+  pthread_mutex_init(&_lock,0);
+}
+
+RegStats::~RegStats()
+{
+  pthread_mutex_destroy(&_lock);
+}
+
+void RegStats::reset()
+{
+  pthread_mutex_lock(&_lock);
+  _regs.clear();
+  _apis.clear();
+  pthread_mutex_unlock(&_lock);
+}
+
+void RegStats::recordReg(const char* name, unsigned bytes, bool write,
+                         uint64_t ns, bool error)
+{
+  pthread_mutex_lock(&_lock);
+  _record(_regs[name], bytes, write, ns, error);
+  pthread_mutex_unlock(&_lock);
+}
+
+void RegStats::recordApi(const char* cls, const char* name,
+                         uint64_t ns, bool error)
+{
+  std::string key(cls);
+  key += "::";
+  key += name;
+  pthread_mutex_lock(&_lock);
+  _record(_apis[key], 0, false, ns, error);
+  pthread_mutex_unlock(&_lock);
+}
+
+RegStats::EntryMap RegStats::registers() const
+{
+  pthread_mutex_lock(&_lock);
+  EntryMap m(_regs);
+  pthread_mutex_unlock(&_lock);
+  return m;
+}
+
+RegStats::EntryMap RegStats::apis() const
+{
+  pthread_mutex_lock(&_lock);
+  EntryMap m(_apis);
+  pthread_mutex_unlock(&_lock);
+  return m;
+}
+
+void RegStats::dump(FILE* f) const
+{
+  _dump(f, "-- API", apis());
+  _dump(f, "-- Register", registers());
+}
+
+int RegStats::dump(const char* fname) const
+{
+  FILE* f = fopen(fname,"w");
+  if (!f) {
+    perror("RegStats::dump");
+    return -1;
+  }
+  dump(f);
+  fclose(f);
+  return 0;
+}
+
+uint64_t RegProbe::now()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return uint64_t(ts.tv_sec)*1000000000ULL + ts.tv_nsec;
+}
+
+void RegProbe::record()
+{
+  uint64_t dt = now()-_t0;
+  //  Only an exception thrown since the probe was made is its error
+  bool error = std::uncaught_exceptions() > _uncaught;
+  if (_cls)
+    _stats->recordApi(_cls, _name, dt, error);
+  else
+    _stats->recordReg(_name, _bytes, _write, dt, error);
+}
@@ -0,0 +1,105 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef Cphw_RegStats_hh
+#define Cphw_RegStats_hh
+
+//
+//  Register transaction statistics.
+//  Counts transactions, bytes, errors and latency per register and per
+//  API entry point.  Disabled by default; when disabled a probe costs one
+//  load and branch.
+//
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#include <exception>
+#include <map>
+#include <string>
+
+namespace Cphw {
+
+  class RegStats {
+  public:
+    //  Latency bins as Cphw::LogHist
+    enum { NBINS = 24 };
+    class Entry {
+    public:
+      Entry();
+    public:
+      uint64_t count;    // transactions (registers) or calls (APIs)
+      uint64_t writes;
+      uint64_t bytes;
+      uint64_t errors;   // transactions that threw
+      uint64_t totNs;
+      uint64_t maxNs;
+      uint64_t hist[NBINS];
+    public:
+      double   percentileUs(double f) const;  // upper edge of the bin
+    };
+    typedef std::map<std::string,Entry> EntryMap;
+  public:
+    RegStats();
+    ~RegStats();
+  public:
+    bool     enabled() const { return _enabled; }
+    void     enable (bool v) { _enabled = v; }
+    void     reset  ();
+  public:
+    void     recordReg(const char* name, unsigned bytes, bool write,
+                       uint64_t ns, bool error);
+    void     recordApi(const char* cls, const char* name,
+                       uint64_t ns, bool error);
+  public:
+    EntryMap registers() const;
+    EntryMap apis     () const;
+    void     dump     (FILE*) const;
+    int      dump     (const char* fname) const;
+  private:
+    RegStats(const RegStats&);
+    RegStats& operator=(const RegStats&);
+  private:
+    volatile bool           _enabled;
+    mutable pthread_mutex_t _lock;
+    EntryMap                _regs;
+    EntryMap                _apis;
+  };
+
+  //
+  //  Scoped probe; records on destruction.  A probe destroyed by a
+  //  propagating exception is counted as an error.
+  //
+  class RegProbe {
+  public:
+    RegProbe(RegStats* s, const char* reg, unsigned bytes, bool write) :
+      _stats(s && s->enabled() ? s : 0), _cls(0), _name(reg),
+      _bytes(bytes), _write(write)
+    { if (_stats) start(); }
+    RegProbe(RegStats* s, const char* cls, const char* api) :
+      _stats(s && s->enabled() ? s : 0), _cls(cls), _name(api),
+      _bytes(0), _write(false)
+    { if (_stats) start(); }
+    ~RegProbe() { if (_stats) record(); }
+  private:
+    static uint64_t now();
+    void            start () { _uncaught = std::uncaught_exceptions(); _t0 = now(); }
+    void            record();
+  private:
+    RegStats*   _stats;
+    const char* _cls;
+    const char* _name;
+    unsigned    _bytes;
+    bool        _write;
+    int         _uncaught;  // exceptions in flight at construction
+    uint64_t    _t0;
+  };
+};
+
+#endif
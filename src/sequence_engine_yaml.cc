@@ -10,6 +10,8 @@
 #include "sequence_engine_yaml.hh"
 #include "user_sequence.hh"
 #include "tpg.hh"
+#include "tpg_regs.hh"
+#include "regstats.hh"
  
 #include <climits>
 #include <map>
@@ -24,6 +26,12 @@ static const char* StartAddrName(unsigned engine) {
 
 static unsigned _verbose=0;
 
+using Cphw::RegStats;
+using Cphw::RegProbe;
+
+//  Per entry point statistics; see regstats.hh
+#define SEQ_API  RegProbe _api(_private->_stats,"SequenceEngineYaml",__func__)
+
 namespace TPGen {
 
   class SeqCache {
@@ -35,31 +43,26 @@ namespace TPGen {
   
   class SeqJump {
   public:
-    SeqJump(Path p, unsigned iengine) :
+    SeqJump(Path p, unsigned iengine, RegStats* stats) :
       _startAddr(IScalVal::create(p->findByName(StartAddrName(iengine)))),
-      _engine   (iengine)
+      _engine   (iengine),
+      _stats    (stats)
     {}
   public:
     void    setManStart(unsigned   addr, unsigned pclass, unsigned sync) { 
-      IndexRange rng(15);   
       unsigned v = (addr&0xfff) | ((pclass&0xf)<<12) | (sync<<16);
-      _startAddr->setVal(&v,1,&rng); 
-      _startAddrCache[15] = v;
+      _set(15,v);
     }
     void    setBcsStart(unsigned   addr,
                         unsigned   pclass) { 
-      IndexRange rng(14);
       unsigned v = (addr&0xfff) | ((pclass&0xf)<<12);
-      _startAddr->setVal(&v,1,&rng); 
-      _startAddrCache[14] = v;
+      _set(14,v);
     }
     void    setMpsStart(unsigned   chan,
                         unsigned   addr,
                         unsigned   pclass) { 
-      IndexRange rng(chan); 
       unsigned v = (addr&0xfff) | ((pclass&0xf)<<12);
-      _startAddr->setVal(&v,1,&rng); 
-      _startAddrCache[chan] = v;
+      _set(chan,v);
     }
     void    setMpsState(unsigned   val ,
                         unsigned   sync) 
@@ -68,46 +71,58 @@ namespace TPGen {
       p = (a>>12)&0xf;
       a &= 0xfff;
       setManStart(a,p,sync); }
-      
+ private:
+    void    _set(unsigned i, unsigned v) {
+      RegProbe p(_stats, Regs::SeqJumpStartAddr.path, 4, true);
+      IndexRange rng(i);
+      _startAddr->setVal(&v,1,&rng); 
+      _startAddrCache[i] = v;
+    }
  private:
     ScalVal _startAddr;
     unsigned _engine;
     unsigned _startAddrCache[16];
+    RegStats* _stats;
   };
 
   class SeqWord {
   public:
-    SeqWord(ScalVal s, unsigned index) :
-      _s(s), _rng(index) {}
+    SeqWord(ScalVal s, unsigned index, RegStats* stats) :
+      _s(s), _rng(index), _stats(stats) {}
   public:
     operator unsigned() const {
+      RegProbe p(_stats, Regs::SeqMemArray.path, 4, false);
       unsigned v;
       _s->getVal(&v,1,&_rng);
       return v;
     }
     SeqWord& operator=(unsigned v) {
+      RegProbe p(_stats, Regs::SeqMemArray.path, 4, true);
       _s->setVal(&v,1,&_rng);
       return *this;
     }
   private:
     ScalVal  _s;
     mutable IndexRange _rng;
+    RegStats* _stats;
   };
 
   class SeqRam {
   public:
-    SeqRam(Path p, unsigned iengine) :
+    SeqRam(Path p, unsigned iengine, RegStats* stats) :
       _scal(IScalVal::create(p->findByName("MemoryArray"))),
-      _word(_scal,0)
+      _word(_scal,0,stats),
+      _stats(stats)
     {}
   public:
     SeqWord& operator[](unsigned i) { 
-      _word = SeqWord(_scal,i);
+      _word = SeqWord(_scal,i,_stats);
       return _word;
     }
   private:
     ScalVal  _scal;
     SeqWord  _word; // won't allow copying from one location to another
+    RegStats* _stats;
   };
 
   class SequenceEngineYaml::PrivateData {
@@ -117,14 +132,16 @@ namespace TPGen {
                 ScalVal  start,
                 Path     jumpPath,
                 unsigned id,
-                ControlRequest::Type req) :
-      _ram    (ramPath,id),
+                ControlRequest::Type req,
+                RegStats* stats) :
+      _ram    (ramPath,id,stats),
       _reset  (reset),
       _start  (start),
-      _jump   (new SeqJump(jumpPath,id)),
+      _jump   (new SeqJump(jumpPath,id,stats)),
       _id     (id),
       _request_type(req),
-      _indices(0) {}
+      _indices(0),
+      _stats  (stats) {}
   public:
     SeqRam                       _ram;
     ScalVal                      _reset;
@@ -135,6 +152,7 @@ namespace TPGen {
     uint64_t                     _indices;  // bit mask of reserved indices
     std::map<unsigned,SeqCache>  _caches;   // map start address to sequence
     std::map<unsigned,Callback*> _callback;
+    RegStats*                    _stats;
   };
 };
 
@@ -227,13 +245,15 @@ SequenceEngineYaml::SequenceEngineYaml(Path    ramPath,
                                        Path    jumpPath,
                                        uint32_t  id,
                                        ControlRequest::Type req,
-                                       unsigned  addrWidth) :
+                                       unsigned  addrWidth,
+                                       RegStats* stats) :
   _private(new SequenceEngineYaml::PrivateData(ramPath,
                                                reset,
                                                start,
                                                jumpPath,
                                                id,
-                                               req))
+                                               req,
+                                               stats))
 {
   _private->_indices = 3;
 
@@ -264,6 +284,7 @@ SequenceEngineYaml::~SequenceEngineYaml()
 
 int  SequenceEngineYaml::insertSequence(std::vector<Instruction*>& seq)
 {
+  SEQ_API;
   int rval=0, aindex=-3;
 
   do {
@@ -402,6 +423,7 @@ int  SequenceEngineYaml::insertSequence(std::vector<Instruction*>& seq)
 
 int  SequenceEngineYaml::removeSequence(int index)
 {
+  SEQ_API;
   if ((_private->_indices&(1ULL<<index))==0) return -1;
   _private->_indices &= ~(1ULL<<index);
 
@@ -431,6 +453,7 @@ int  SequenceEngineYaml::removeSequence(int index)
 
 void SequenceEngineYaml::setAddress  (int seq, unsigned start, unsigned sync)
 {
+  SEQ_API;
   int a = _lookup_address(_private->_caches,seq,start);
   if (a>=0) {
     _private->_jump->setManStart(a,0,sync);
@@ -439,17 +462,21 @@ void SequenceEngineYaml::setAddress  (int seq, unsigned start, unsigned sync)
 
 void SequenceEngineYaml::reset() 
 {
+  SEQ_API;
   uint32_t v[4];
   memset(v,0,sizeof(v));
   v[_private->_id >> 5] = 1U<<(_private->_id & 0x1f);
-  { IndexRange rng(0,3);
+  { RegProbe p(_private->_stats, Regs::SeqRestart.path, sizeof(v), true);
+    IndexRange rng(0,3);
     _private->_reset->setVal(v,4,&rng); }
-  { IndexRange rng(0);
+  { RegProbe p(_private->_stats, Regs::SeqRestartGo.path, sizeof(v[0]), true);
+    IndexRange rng(0);
     _private->_start->setVal(v,1,&rng); }  // the value doesn't matter
 }
 
 void SequenceEngineYaml::setMPSJump    (int mps, int seq, unsigned pclass, unsigned start)
 {
+  SEQ_API;
   if (seq>=0) {
     int a = _lookup_address(_private->_caches,seq,start);
     if (a>=0) {
@@ -463,6 +490,7 @@ void SequenceEngineYaml::setMPSJump    (int mps, int seq, unsigned pclass, unsig
 
 void SequenceEngineYaml::setBCSJump    (int seq, unsigned pclass, unsigned start)
 {
+  SEQ_API;
   if (seq>=0) {
     int a = _lookup_address(_private->_caches,seq,start);
     if (a>=0) {
@@ -475,6 +503,7 @@ void SequenceEngineYaml::setBCSJump    (int seq, unsigned pclass, unsigned start
 
 void SequenceEngineYaml::setMPSState  (int mps, unsigned sync)
 {
+  SEQ_API;
   _private->_jump->setMpsState(mps,sync);
   reset();
 }
@@ -18,6 +18,8 @@
 #include "sequence_engine.hh"
 #include <cpsw_api_user.h>
 
+namespace Cphw { class RegStats; };
+
 namespace TPGen {
   class JumpTable;
   class LegacyRegister;
@@ -50,7 +52,8 @@ namespace TPGen {
                        Path      jumpPath,
                        unsigned  id,
                        ControlRequest::Type req_type,
-                       unsigned  addrWidth=11);
+                       unsigned  addrWidth=11,
+                       Cphw::RegStats* stats=0);
     ~SequenceEngineYaml();
   protected:
     friend class TPGYaml;
@@ -21,6 +21,7 @@
 #include <cpsw_yaml.h>
 
 #include "hps_utils.hh"
+#include "yaml_cache.hh"
 #include "tpg_yaml.hh"
 #include "sequence_engine_yaml.hh"
 
@@ -76,7 +77,7 @@ int main(int argc, char* argv[])
   }
 
   IYamlFixup* fixup = new Cphw::IpAddrFixup(ip);
-  Path path = IPath::loadYamlFile(yaml_file,yaml_path,0,fixup);
+  Path path = Cphw::YamlCache::load(yaml_file,yaml_path,fixup);
   delete fixup;
 
   TPGen::TPGYaml* tpg = new TPGen::TPGYaml(path,false);
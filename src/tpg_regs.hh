@@ -0,0 +1,126 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef TPGEN_TPG_REGS_HH
+#define TPGEN_TPG_REGS_HH
+
+//
+//  Registers of the AmcCarrierTimingGenerator used by TPGYaml.
+//  The yaml for this firmware is delivered with the firmware image and not
+//  with this package, so offsets are left to the CPSW hierarchy and the
+//  descriptors carry the path (relative to mmio/AmcCarrierTimingGenerator),
+//  the number of elements addressed by the driver and the access mode.
+//
+//  Arrays of devices (e.g. DestDiagControl[8]) are addressed as a flattened
+//  array of their leaf register.  nelms of 0 means the length is set by
+//  the firmware build (see TPGControl/N*).
+//
+#include "regmap.hh"
+
+#define TPG_REGS(X)                                                     \
+  X(NBeamSeq          , "ApplicationCore/TPG/TPGControl/NBeamSeq"          ,  1, RO) \
+  X(NAllowSeq         , "ApplicationCore/TPG/TPGControl/NAllowSeq"         ,  1, RO) \
+  X(NControlSeq       , "ApplicationCore/TPG/TPGControl/NControlSeq"       ,  1, RO) \
+  X(NDestDiag         , "ApplicationCore/TPG/TPGControl/NDestDiag"         ,  1, RO) \
+  X(NArraysBsa        , "ApplicationCore/TPG/TPGControl/NArraysBsa"        ,  1, RO) \
+  X(SeqAddrLen        , "ApplicationCore/TPG/TPGControl/SeqAddrLen"        ,  1, RO) \
+  X(ClockPeriodDiv    , "ApplicationCore/TPG/TPGControl/ClockPeriodDiv"    ,  1, RW) \
+  X(ClockPeriodRem    , "ApplicationCore/TPG/TPGControl/ClockPeriodRem"    ,  1, RW) \
+  X(ClockPeriodInt    , "ApplicationCore/TPG/TPGControl/ClockPeriodInt"    ,  1, RW) \
+  X(BaseControl       , "ApplicationCore/TPG/TPGControl/BaseControl"       ,  1, RW) \
+  X(ACMaster          , "ApplicationCore/TPG/TPGControl/ACMaster"          ,  1, RW) \
+  X(ACTS1             , "ApplicationCore/TPG/TPGControl/ACTS1"             ,  1, RW) \
+  X(ACPolarity        , "ApplicationCore/TPG/TPGControl/ACPolarity"        ,  1, RW) \
+  X(ACDelay           , "ApplicationCore/TPG/TPGControl/ACDelay"           ,  1, RW) \
+  X(PulseId           , "ApplicationCore/TPG/TPGControl/PulseId"           ,  1, RW) \
+  X(TStamp            , "ApplicationCore/TPG/TPGControl/TStamp"            ,  1, RW) \
+  X(ACRateDiv         , "ApplicationCore/TPG/TPGControl/ACRateDiv"         ,  6, RW) \
+  X(FixedRateDiv      , "ApplicationCore/TPG/TPGControl/FixedRateDiv"      , 10, RW) \
+  X(RateReload        , "ApplicationCore/TPG/TPGControl/RateReload"        ,  1, RW) \
+  X(BeamCharge        , "ApplicationCore/TPG/TPGControl/BeamCharge"        ,  1, RW) \
+  X(BeamChargeOverride, "ApplicationCore/TPG/TPGControl/BeamChargeOverride",  1, RW) \
+  X(BeamDiagControl   , "ApplicationCore/TPG/TPGControl/BeamDiagControl"   ,  1, RW) \
+  X(BeamDiagHoldoff   , "ApplicationCore/TPG/TPGControl/BeamDiagHoldoff"   ,  1, RW) \
+  X(BeamDiagInhibit   , "ApplicationCore/TPG/TPGControl/BeamDiagInhibit"   ,  1, RW) \
+  X(BeamDiagStatus    , "ApplicationCore/TPG/TPGControl/BeamDiagStatus"    ,  4, RO) \
+  X(BeamDiagCount     , "ApplicationCore/TPG/TPGControl/BeamDiagCount"     ,  1, RO) \
+  X(BcsLatch          , "ApplicationCore/TPG/TPGControl/BcsLatch"          ,  1, RO) \
+  X(BeamEnergy        , "ApplicationCore/TPG/TPGControl/BeamEnergy"        ,  4, RW) \
+  X(PhotonWavelen     , "ApplicationCore/TPG/TPGControl/PhotonWavelen"     ,  2, RW) \
+  X(BeamSeqAllowMask  , "ApplicationCore/TPG/TPGControl/BeamSeqAllowMask"  , 16, RW) \
+  X(BeamSeqDestination, "ApplicationCore/TPG/TPGControl/BeamSeqDestination", 16, RW) \
+  X(DiagSeq           , "ApplicationCore/TPG/TPGControl/DiagSeq"           ,  1, RW) \
+  X(IrqControl        , "ApplicationCore/TPG/TPGControl/IrqControl"        ,  1, RW) \
+  X(IrqStatus         , "ApplicationCore/TPG/TPGControl/IrqStatus"         ,  1, RW) \
+  X(SeqFifoData       , "ApplicationCore/TPG/TPGControl/SeqFifoData"       ,  1, RO) \
+  X(MpsState          , "ApplicationCore/TPG/TPGControl/MpsState"          , 16, RO) \
+  X(BsaComplete       , "ApplicationCore/TPG/TPGControl/BsaComplete"       ,  1, RW) \
+  X(BsaEventSel       , "ApplicationCore/TPG/TPGControl/BsaEventSel"       , 64, RW) \
+  X(BsaStatSel        , "ApplicationCore/TPG/TPGControl/BsaStatSel"        , 64, RW) \
+  X(SeqRestart        , "ApplicationCore/TPG/TPGControl/SeqRestart"        ,  4, RW) \
+  X(SeqRestartGo      , "ApplicationCore/TPG/TPGControl/SeqRestartGo"      ,  1, RW) \
+  X(GenStatus         , "ApplicationCore/TPG/TPGControl/GenStatus"         ,  1, RW) \
+  X(CounterLock       , "ApplicationCore/TPG/TPGControl/CounterLock"       ,  1, RW) \
+  X(CounterDef        , "ApplicationCore/TPG/TPGControl/CounterDef"        , 24, RW) \
+  X(CountPLL          , "ApplicationCore/TPG/TPGStatus/CountPLL"           ,  1, RO) \
+  X(Count186M         , "ApplicationCore/TPG/TPGStatus/Count186M"          ,  1, RO) \
+  X(CountSyncE        , "ApplicationCore/TPG/TPGStatus/CountSyncE"         ,  1, RO) \
+  X(CountIntv         , "ApplicationCore/TPG/TPGStatus/CountIntv"          ,  1, RW) \
+  X(CountBRT          , "ApplicationCore/TPG/TPGStatus/CountBRT"           ,  1, RO) \
+  X(CountTrig         , "ApplicationCore/TPG/TPGStatus/CountTrig"          , 12, RO) \
+  X(CountSeq          , "ApplicationCore/TPG/TPGStatus/CountSeq"           ,  0, RO) \
+  X(BsaStatus         , "ApplicationCore/TPG/TPGStatus/BsaStatus"          , 64, RO) \
+  X(BsaTimestamp      , "ApplicationCore/TPG/TPGStatus/BsaTimestamp"       , 64, RO) \
+  X(SeqMemArray       , "ApplicationCore/TPG/TPGSeqMem/ICache/MemoryArray"    ,  0, RW) \
+  X(SeqJumpStartAddr  , "ApplicationCore/TPG/TPGSeqJump/StartAddr/MemoryArray",  0, RW) \
+  X(SeqIndex          , "ApplicationCore/TPG/TPGSeqState/SeqIndex"         ,  0, RO) \
+  X(SeqCondACount     , "ApplicationCore/TPG/TPGSeqState/SeqCondACount"    ,  0, RO) \
+  X(SeqCondBCount     , "ApplicationCore/TPG/TPGSeqState/SeqCondBCount"    ,  0, RO) \
+  X(SeqCondCCount     , "ApplicationCore/TPG/TPGSeqState/SeqCondCCount"    ,  0, RO) \
+  X(SeqCondDCount     , "ApplicationCore/TPG/TPGSeqState/SeqCondDCount"    ,  0, RO) \
+  X(DestDiagMask      , "ApplicationCore/DestDiagControl/DestMask"         ,  8, RW) \
+  X(DestDiagInterval  , "ApplicationCore/DestDiagControl/Interval"         , 32, RW) \
+  X(DestnRate         , "ApplicationCore/DestnRate/Destn"                  , 16, RO) \
+  X(JesdResetGTs      , "ApplicationCore/AppTopJesd/JesdRx/ResetGTs"       ,  1, RW) \
+  X(MpsPhyReadyRx     , "ApplicationCore/TPGMps/Pgp2bAxi/PhyReadyRx"       ,  1, RO) \
+  X(MpsPhyReadyTx     , "ApplicationCore/TPGMps/Pgp2bAxi/PhyReadyTx"       ,  1, RO) \
+  X(MpsLocalLinkReady , "ApplicationCore/TPGMps/Pgp2bAxi/LocalLinkReady"   ,  1, RO) \
+  X(MpsRemoteLinkReady, "ApplicationCore/TPGMps/Pgp2bAxi/RemoteLinkReady"  ,  1, RO) \
+  X(MpsRxClockFreq    , "ApplicationCore/TPGMps/Pgp2bAxi/RxClockFreq"      ,  1, RO) \
+  X(MpsTxClockFreq    , "ApplicationCore/TPGMps/Pgp2bAxi/TxClockFreq"      ,  1, RO) \
+  X(MpsRxFrameErrCnt  , "ApplicationCore/TPGMps/Pgp2bAxi/RxFrameErrCnt"    ,  1, RO) \
+  X(MpsRxFrameCnt     , "ApplicationCore/TPGMps/Pgp2bAxi/RxFrameCnt"       ,  1, RO) \
+  X(CpllLocked        , "AmcCarrierCore/AmcCarrierTiming/MonitorCpll/Locked"          , 1, RO) \
+  X(CpllRefclkLost    , "AmcCarrierCore/AmcCarrierTiming/MonitorCpll/RefclkLost"      , 1, RO) \
+  X(CpllLockCounts    , "AmcCarrierCore/AmcCarrierTiming/MonitorCpll/LockCounts"      , 1, RO) \
+  X(CpllRefclkLostCounts, "AmcCarrierCore/AmcCarrierTiming/MonitorCpll/RefclkLostCounts", 1, RO) \
+  X(BsaWfStartAddr    , "AmcCarrierCore/AmcCarrierBsa/BsaWaveformEngine[0]/WaveformEngineBuffers/StartAddr", 4, RW) \
+  X(BsaWfEndAddr      , "AmcCarrierCore/AmcCarrierBsa/BsaWaveformEngine[0]/WaveformEngineBuffers/EndAddr"  , 4, RW) \
+  X(BsaWfEnabled      , "AmcCarrierCore/AmcCarrierBsa/BsaWaveformEngine[0]/WaveformEngineBuffers/Enabled"  , 4, RW) \
+  X(BsaWfMode         , "AmcCarrierCore/AmcCarrierBsa/BsaWaveformEngine[0]/WaveformEngineBuffers/Mode"     , 4, RW) \
+  X(BsaWfInit         , "AmcCarrierCore/AmcCarrierBsa/BsaWaveformEngine[0]/WaveformEngineBuffers/Init"     , 4, RW)
+
+namespace TPGen {
+  namespace Regs {
+    using Cphw::RegDesc;
+
+    enum Index {
+#define TPG_REG_INDEX(name,path,nelms,mode) name##_index,
+      TPG_REGS(TPG_REG_INDEX)
+#undef TPG_REG_INDEX
+      NREGS };
+
+#define TPG_REG_DESC(name,path,nelms,mode)                              \
+    constexpr RegDesc name = { name##_index, path, nelms, RegDesc::mode };
+    TPG_REGS(TPG_REG_DESC)
+#undef TPG_REG_DESC
+  };
+};
+
+#endif
@@ -10,6 +10,9 @@
 #include "tpg_yaml.hh"
 #include "sequence_engine_yaml.hh"
 #include "event_selection.hh"
+#include "tpg_regs.hh"
+#include "hps_regmap.hh"
+#include "regstats.hh"
 
 //#include <TPG.hh>
 //#include <AmcCarrier.hh>
@@ -33,6 +36,8 @@ static const unsigned MAXACQBSA  = (1<<16)-1;
 static const unsigned MAXAVGBSA  = (1<<13)-1;
 static const unsigned MAX_AC_DELAY    = (1<<16)-1;
 static const unsigned NRATECOUNTERS = 24;
+static const unsigned NDESTDIAGINTV = 4;   // DestDiagControl[]/Interval
+static const unsigned NSEQJUMPADDR  = 16;  // TPGSeqJump/StartAddr[]/MemoryArray
 
 enum { IRQ_CHECKPOINT=0,
        IRQ_INTERVAL  =1,
@@ -53,47 +58,71 @@ static uint64_t GET_U1(Path pre)
   return r;
 }
 
-static uint8_t _GET_U8(const char* name, Path path) 
+using Cphw::RegDesc;
+using Cphw::RegBlock;
+using Cphw::RegStats;
+using Cphw::RegProbe;
+
+template <class T>
+static void _GET(RegBlock& b, const RegDesc& r, T* v, unsigned n=1, IndexRange* rng=0)
+{
+  RegProbe p(b.stats(), r.path, n*sizeof(T), false);
+  b.ro(r)->getVal(v,n,rng);
+}
+
+template <class T>
+static void _SET(RegBlock& b, const RegDesc& r, T* v, unsigned n=1, IndexRange* rng=0)
+{
+  RegProbe p(b.stats(), r.path, n*sizeof(T), true);
+  b.rw(r)->setVal(v,n,rng);
+}
+
+static uint8_t _GET_U8(RegBlock& b, const RegDesc& r) 
 {
   uint8_t v;
-  IScalVal_RO::create(path->findByName(name))->getVal(&v);
+  _GET(b,r,&v);
   return v;
 }
 
-static uint8_t _GET_U8(const char* name, Path path, unsigned index) 
+static uint8_t _GET_U8(RegBlock& b, const RegDesc& r, unsigned index) 
 {
   IndexRange rng(index);
   uint8_t v;
-  IScalVal_RO::create(path->findByName(name))->getVal(&v,1,&rng);
+  _GET(b,r,&v,1,&rng);
   return v;
 }
 
-static unsigned _GET_U32(const char* name, Path path) 
+static unsigned _GET_U32(RegBlock& b, const RegDesc& r) 
 {
   unsigned v;
-  IScalVal_RO::create(path->findByName(name))->getVal(&v,1);
+  _GET(b,r,&v);
   return v;
 }
 
-static unsigned _GET_U32(const char* name, Path path, unsigned index) 
+static unsigned _GET_U32(RegBlock& b, const RegDesc& r, unsigned index) 
 {
   IndexRange rng(index);
   unsigned v;
-  IScalVal_RO::create(path->findByName(name))->getVal(&v,1,&rng);
+  _GET(b,r,&v,1,&rng);
   return v;
 }
 
-static uint64_t _GET_U64(const char* name, Path path) 
+static uint64_t _GET_U64(RegBlock& b, const RegDesc& r) 
 {
   uint64_t v;
-  IScalVal_RO::create(path->findByName(name))->getVal(&v,1);
+  _GET(b,r,&v);
   return v;
 }
 
-static void _SET_U32(const char* name, Path path, unsigned r) 
+static void _SET_U32(RegBlock& b, const RegDesc& r, unsigned v) 
+{
+  _SET(b,r,&v);
+}
+
+static void _SET_U32(RegBlock& b, const RegDesc& r, unsigned v, unsigned index) 
 {
-  unsigned v(r);
-  IScalVal::create(path->findByName(name))->setVal(&v,1);
+  IndexRange rng(index);
+  _SET(b,r,&v,1,&rng);
 }
 
 #define CPSW_TRY_CATCH(X)       try {   \
@@ -106,16 +135,21 @@ static void _SET_U32(const char* name, Path path, unsigned r)
         throw e;                        \
     }
 
-#define GET_U32(name)   _GET_U32("TPGControl/"#name,_private->tpg)
-#define GET_U8(name)    _GET_U8("TPGControl/"#name,_private->tpg)
-#define GET_U8I(name,i) _GET_U8("TPGControl/"#name,_private->tpg,i)
-#define GET_U32I(name,i) _GET_U32("TPGControl/"#name,_private->tpg,i)
-#define GET_U64(name)   _GET_U64("TPGControl/"#name,_private->tpg)
-#define SET_U32(name,v) _SET_U32("TPGControl/"#name,_private->tpg,v)
-#define SET_REG(name,v) IScalVal::create(_private->tpg->findByName("TPGControl/"#name))->setVal(&v,1)
-#define SET_U32S(name,v) _SET_U32("TPGStatus/"#name,_private->tpg,v)
-#define GET_U32S(name)   _GET_U32("TPGStatus/"#name,_private->tpg)
-#define GET_U32SI(name,i) _GET_U32("TPGStatus/"#name,_private->tpg,i)
+//  Registers are named by their descriptors in tpg_regs.hh
+#define GET_U32(name)   _GET_U32(_private->regs,Regs::name)
+#define GET_U8(name)    _GET_U8(_private->regs,Regs::name)
+#define GET_U8I(name,i) _GET_U8(_private->regs,Regs::name,i)
+#define GET_U32I(name,i) _GET_U32(_private->regs,Regs::name,i)
+#define GET_U64(name)   _GET_U64(_private->regs,Regs::name)
+#define SET_U32(name,v) _SET_U32(_private->regs,Regs::name,v)
+#define SET_U32I(name,v,i) _SET_U32(_private->regs,Regs::name,v,i)
+#define SET_REG(name,v) _SET(_private->regs,Regs::name,&v)
+#define GET_REGV(name,...) _GET(_private->regs,Regs::name,__VA_ARGS__)
+#define SET_REGV(name,...) _SET(_private->regs,Regs::name,__VA_ARGS__)
+#define RW_REG(name)    _private->regs.rw(Regs::name)
+
+//  Per entry point statistics; see regstats.hh
+#define TPG_API         RegProbe _api(&_private->stats,"TPGYaml",__func__)
 
 
 
@@ -144,37 +178,55 @@ namespace TPGen {
 
   class TPGYaml::PrivateData {
   public:
-    PrivateData() : intervalCallback(0), faultCallback(0) {}
-    ~PrivateData() {}
+    PrivateData(Path r) : 
+      root   (r),
+      tpg    (r->findByName("mmio/AmcCarrierTimingGenerator/ApplicationCore/TPG")),
+      regs   (r->findByName("mmio/AmcCarrierTimingGenerator"), Regs::NREGS),
+      frameRx(r->findByName("mmio/AmcCarrierTimingGenerator/AmcCarrierCore/AmcCarrierTiming/TimingFrameRx"), 
+              Cphw::Regs::TimingFrameRx::NREGS),
+      xbar   (r->findByName("mmio/AmcCarrierTimingGenerator/AmcCarrierCore/AxiSy56040"), 
+              Cphw::Regs::AxiSy56040::NREGS),
+      intervalCallback(0), faultCallback(0),
+      captureInterval(false), intervalFront(0)
+    { regs   .stats(&stats);
+      frameRx.stats(&stats);
+      xbar   .stats(&stats);
+      interval[0].seq = interval[1].seq = 0;
+      pthread_mutex_init(&intervalLock,0); }
+    ~PrivateData() { pthread_mutex_destroy(&intervalLock); }
   public:
+    RegStats                         stats;
     Path                             root;
     Path                             tpg;
-    Path                             core;
-    ScalVal_RO                       bsaComplete;
-    ScalVal_RO                       bsaTimestamp;
+    RegBlock                         regs;
+    RegBlock                         frameRx;
+    RegBlock                         xbar;
     std::vector<SequenceEngineYaml*> sequences;
     std::map<unsigned,Callback*>     bsaCallback;
     Callback*                        intervalCallback;
     Callback*                        faultCallback;
+    //  Interval capture: the irq thread fills interval[intervalFront^1]
+    //  and swaps under intervalLock; readers copy interval[intervalFront]
+    bool                             captureInterval;
+    TPGIntervalCounters              interval[2];
+    unsigned                         intervalFront;
+    mutable pthread_mutex_t          intervalLock;
   };
 
   TPGYaml::TPGYaml(Path root, bool initialize) :
-    _private(new PrivateData)
+    _private(new PrivateData(root))
   {
-    _private->root        = root;
-    _private->tpg         = root->findByName("mmio/AmcCarrierTimingGenerator/ApplicationCore/TPG");
-    _private->core        = root->findByName("mmio/AmcCarrierTimingGenerator/ApplicationCore");
-    _private->bsaComplete = IScalVal_RO::create(_private->tpg->findByName("TPGControl/BsaComplete"));
-    _private->bsaTimestamp = IScalVal_RO::create(_private->tpg->findByName("TPGStatus/BsaTimestamp"));
 
     const unsigned NALLOWSEQ  = nAllowEngines();
     const unsigned NBEAMSEQ   = nAllowEngines()+nBeamEngines();
     const unsigned NSEQUENCES = nAllowEngines()+nBeamEngines()+nExptEngines();
     const unsigned SEQADDRW   = seqAddrWidth();
     char buff[256];
-    ScalVal seqReset = IScalVal::create(_private->tpg->findByName("TPGControl/SeqRestart"));
-    ScalVal seqStart = IScalVal::create(_private->tpg->findByName("TPGControl/SeqRestartGo"));
+    ScalVal seqReset = RW_REG(SeqRestart);
+    ScalVal seqStart = RW_REG(SeqRestartGo);
     _private->sequences.reserve(NSEQUENCES);
+    _private->interval[0].seqRequests.resize(NSEQUENCES*4);
+    _private->interval[1].seqRequests.resize(NSEQUENCES*4);
     
     for(unsigned i=0; i<NSEQUENCES; i++) {
       sprintf(buff,"TPGSeqMem/ICache[%u]",i);
@@ -189,7 +241,8 @@ namespace TPGen {
                                i,
                                i<NBEAMSEQ ?
                                ControlRequest::Beam : ControlRequest::Expt,
-                               SEQADDRW);
+                               SEQADDRW,
+                               &_private->stats);
     }
     //  Start the asynchronous notification thread
     //  Shut it down (gracefully?) when the application exits
@@ -214,32 +267,32 @@ namespace TPGen {
   { return 0; }
 
   unsigned TPGYaml::nBeamEngines () const
-  { unsigned n;
+  { TPG_API; unsigned n;
     CPSW_TRY_CATCH( n = GET_U32(NBeamSeq) );
     return n; }
 
   unsigned TPGYaml::nAllowEngines () const
-  { unsigned n;
+  { TPG_API; unsigned n;
     CPSW_TRY_CATCH( n = GET_U32(NAllowSeq) );
     return n; }
 
   unsigned TPGYaml::nExptEngines () const
-  { unsigned n;
+  { TPG_API; unsigned n;
     CPSW_TRY_CATCH( n= GET_U32(NControlSeq) );
     return n; }
 
   unsigned TPGYaml::nDestDiag   () const
-  { unsigned n;
+  { TPG_API; unsigned n;
     CPSW_TRY_CATCH( n = GET_U32(NDestDiag) );
     return n; }
   
   unsigned TPGYaml::nArraysBSA   () const
-  { unsigned n;
+  { TPG_API; unsigned n;
     CPSW_TRY_CATCH( n = GET_U32(NArraysBsa) );
     return n; }
   
   unsigned TPGYaml::seqAddrWidth () const
-  { unsigned n;
+  { TPG_API; unsigned n;
     CPSW_TRY_CATCH( n = GET_U32(SeqAddrLen) );
     return n; }
 
@@ -253,6 +306,7 @@ namespace TPGen {
                              unsigned frac_num,
                              unsigned frac_den)
   {
+    TPG_API;
     if (ns<32 && frac_den<256 && frac_num<frac_den) {
       CPSW_TRY_CATCH( SET_U32(ClockPeriodDiv, frac_den) );
       CPSW_TRY_CATCH( SET_U32(ClockPeriodRem, frac_num) );
@@ -262,18 +316,21 @@ namespace TPGen {
 
   int TPGYaml::setBaseDivisor(unsigned v)
   { 
+    TPG_API;
     CPSW_TRY_CATCH( SET_U32(BaseControl,v) );
     return 0;
   }
 
   void TPGYaml::setACMaster(bool m)
   { 
+    TPG_API;
     unsigned v = m ? 1:0;
     CPSW_TRY_CATCH( SET_REG(ACMaster,v) );
   }
 
   int TPGYaml::setACTS1Chan(unsigned v)
   {
+    TPG_API;
     if (v>2)
       return -1;
     CPSW_TRY_CATCH( SET_REG(ACTS1,v) );
@@ -282,12 +339,14 @@ namespace TPGen {
 
   void TPGYaml::setACPolarity(bool m)
   {
+    TPG_API;
     unsigned v = m ? 1:0;
     CPSW_TRY_CATCH( SET_REG(ACPolarity,v) );
   }
 
   int TPGYaml::setACDelay(unsigned v)
   { 
+    TPG_API;
     if (v > MAX_AC_DELAY)
       return -1;
     CPSW_TRY_CATCH( SET_REG(ACDelay,v) );
@@ -295,45 +354,48 @@ namespace TPGen {
   }
 
   void TPGYaml::setPulseID(uint64_t v)
-  { CPSW_TRY_CATCH( SET_REG(PulseId,v) ); }
+  { TPG_API; CPSW_TRY_CATCH( SET_REG(PulseId,v) ); }
 
   void TPGYaml::setTimestamp(unsigned sec, unsigned nsec)
-  { uint64_t v=sec; v<<=32; v+=nsec; CPSW_TRY_CATCH( SET_REG(TStamp,v) ); }
+  { TPG_API; uint64_t v=sec; v<<=32; v+=nsec; CPSW_TRY_CATCH( SET_REG(TStamp,v) ); }
 
   uint64_t TPGYaml::getPulseID() const
-  { uint64_t u;
+  { TPG_API; uint64_t u;
     CPSW_TRY_CATCH( u =  GET_U64(PulseId) );
     return u; }
 
   void     TPGYaml::getTimestamp(unsigned& sec, 
                                  unsigned& nsec) const
-  { uint64_t v;
+  { TPG_API; uint64_t v;
     CPSW_TRY_CATCH( v = GET_U64(TStamp) );
     sec  = v>>32;
     nsec = v&0xffffffff; }
 
   void TPGYaml::setACDivisors(const std::vector<unsigned>& d)
   {
+    TPG_API;
     std::vector<uint8_t> v(d.size());
     for(unsigned i=0; i<d.size(); i++)
       v[i] = d[i]&0xff;
-    CPSW_TRY_CATCH( IScalVal::create(_private->tpg->findByName("TPGControl/ACRateDiv"))->setVal(v.data(),v.size()) );
+    CPSW_TRY_CATCH( SET_REGV(ACRateDiv,v.data(),v.size()) );
   }
 
   void TPGYaml::setFixedDivisors(const std::vector<unsigned>& d)
   {
-    CPSW_TRY_CATCH( IScalVal::create(_private->tpg->findByName("TPGControl/FixedRateDiv"))->setVal(const_cast<uint32_t*>(d.data()),d.size()) );
+    TPG_API;
+    CPSW_TRY_CATCH( SET_REGV(FixedRateDiv,const_cast<uint32_t*>(d.data()),d.size()) );
   }
 
   void TPGYaml::loadDivisors()
-  { CPSW_TRY_CATCH( SET_U32(RateReload,1) ); }
+  { TPG_API; CPSW_TRY_CATCH( SET_U32(RateReload,1) ); }
 
 
   void TPGYaml::setBeamCharge(unsigned v)
-  { CPSW_TRY_CATCH( SET_REG(BeamCharge, v)); }
+  { TPG_API; CPSW_TRY_CATCH( SET_REG(BeamCharge, v)); }
 
   void TPGYaml::overrideBeamCharge(bool t)
   {
+    TPG_API;
     unsigned zero(0), one(1);
 
     if(t) {
@@ -345,15 +407,12 @@ namespace TPGen {
 
   void TPGYaml::initializeRam()
   {
+    TPG_API;
     const uint64_t BlockMask = (0x1ULL<<12)-1;  // Buffers must be in blocks of 4kB
     const uint64_t bufferSize = (0x1ULL<<24);
     const bool     doneWhenFull = true;
-    const int      index = 0;
+    const int      index = 0;  // BsaWaveformEngine[0] buffer
 
-    char buff[256];
-    sprintf(buff,"mmio/AmcCarrierTimingGenerator/AmcCarrierCore/AmcCarrierBsa/BsaWaveformEngine[%d]/WaveformEngineBuffers", index/4);
-    Path path = _private->root->findByName(buff);
-    
     //  Setup the waveform memory
     //  Assume BSA is within first 4GB
     uint64_t p = (1ULL<<32);
@@ -361,28 +420,28 @@ namespace TPGen {
     uint32_t one(1), zero(0), mode(doneWhenFull ? 1:0);
     IndexRange rng(index%4);
     printf("Setup waveform memory %i %llx:%llx\n", index, p,pn);
-    CPSW_TRY_CATCH( IScalVal::create( path->findByName("StartAddr"))->setVal(&p   ,1,&rng) );
-    CPSW_TRY_CATCH( IScalVal::create( path->findByName("EndAddr"  ))->setVal(&pn  ,1,&rng) );
-    CPSW_TRY_CATCH( IScalVal::create( path->findByName("Enabled"  ))->setVal(&one ,1,&rng) );
-    CPSW_TRY_CATCH( IScalVal::create( path->findByName("Mode"     ))->setVal(&mode,1,&rng) );
-    CPSW_TRY_CATCH( IScalVal::create( path->findByName("Init"     ))->setVal(&one ,1,&rng) );
-    CPSW_TRY_CATCH( IScalVal::create( path->findByName("Init"     ))->setVal(&zero,1,&rng) );
+    CPSW_TRY_CATCH( SET_REGV(BsaWfStartAddr,&p   ,1,&rng) );
+    CPSW_TRY_CATCH( SET_REGV(BsaWfEndAddr,&pn  ,1,&rng) );
+    CPSW_TRY_CATCH( SET_REGV(BsaWfEnabled,&one ,1,&rng) );
+    CPSW_TRY_CATCH( SET_REGV(BsaWfMode,&mode,1,&rng) );
+    CPSW_TRY_CATCH( SET_REGV(BsaWfInit,&one ,1,&rng) );
+    CPSW_TRY_CATCH( SET_REGV(BsaWfInit,&zero,1,&rng) );
   }
 
   void TPGYaml::acquireHistoryBuffers(bool v)
-  { CPSW_TRY_CATCH( SET_U32(BeamDiagControl,1<<31) ); }
+  { TPG_API; CPSW_TRY_CATCH( SET_U32(BeamDiagControl,1<<31) ); }
 
   void TPGYaml::clearHistoryBuffers(unsigned v)
-  { CPSW_TRY_CATCH( SET_U32(BeamDiagControl,1<<v) ); }
+  { TPG_API; CPSW_TRY_CATCH( SET_U32(BeamDiagControl,1<<v) ); }
 
   void TPGYaml::setHistoryBufferHoldoff(unsigned v)
-  { CPSW_TRY_CATCH( SET_U32(BeamDiagHoldoff,v) ); }
+  { TPG_API; CPSW_TRY_CATCH( SET_U32(BeamDiagHoldoff,v) ); }
 
   void TPGYaml::setHistoryBufferInhibit(unsigned v)
-  { CPSW_TRY_CATCH( SET_U32(BeamDiagInhibit,v) ); }
+  { TPG_API; CPSW_TRY_CATCH( SET_U32(BeamDiagInhibit,v) ); }
 
   std::vector<FaultStatus> TPGYaml::getHistoryStatus()
-  { std::vector<FaultStatus> vec(4);
+  { TPG_API; std::vector<FaultStatus> vec(4);
     for(unsigned i=0; i<4; i++) {
       unsigned v;
       CPSW_TRY_CATCH( v = GET_U32I(BeamDiagStatus,i) );
@@ -395,26 +454,29 @@ namespace TPGen {
     return vec; }
 
   unsigned TPGYaml::faultCounts() const
-  { unsigned u;
+  { TPG_API; unsigned u;
     CPSW_TRY_CATCH( u = GET_U32(BeamDiagCount) );
     return u; }
 
   bool TPGYaml::bcsLatched() const
-  { uint8_t u;
+  { TPG_API; uint8_t u;
     CPSW_TRY_CATCH( u = GET_U8(BcsLatch) );
     return u; }
 
   void TPGYaml::setEnergy(const std::vector<unsigned>& energy) {
-    CPSW_TRY_CATCH( IScalVal::create(_private->tpg->findByName("TPGControl/BeamEnergy"))->setVal(const_cast<unsigned*>(energy.data()),4) );
+    TPG_API;
+    CPSW_TRY_CATCH( SET_REGV(BeamEnergy,const_cast<unsigned*>(energy.data()),4) );
   }
 
   void TPGYaml::setWavelength(const std::vector<unsigned>& wavelen) {
-    CPSW_TRY_CATCH( IScalVal::create(_private->tpg->findByName("TPGControl/PhotonWavelen"))->setVal(const_cast<unsigned*>(wavelen.data()),2) );
+    TPG_API;
+    CPSW_TRY_CATCH( SET_REGV(PhotonWavelen,const_cast<unsigned*>(wavelen.data()),2) );
   }
 
   void TPGYaml::dump() const {
+    TPG_API;
 #define printr(reg) printf("%15.15s: %08x\n",#reg,GET_U32(reg))
-#define printrs(reg) printf("%15.15s: %08x\n",#reg,GET_U32S(reg))
+#define printrs(reg) printf("%15.15s: %08x\n",#reg,GET_U32(reg))
 #define printrn(reg,n)                                           \
     printf("%15.15s:",#reg);                                     \
       for(unsigned i=0; i<n; i++) {                              \
@@ -427,13 +489,12 @@ namespace TPGen {
     printf("%15.15s:",#reg);                                     \
       for(unsigned i=0; i<n; i++) {                              \
         IndexRange rng(i);                                       \
-        printf(" %08x",GET_U32SI(reg,i));                        \
+        printf(" %08x",GET_U32I(reg,i));                        \
         if ((i%10)==9) printf("\n                ");             \
       }                                                          \
       printf("\n")
 #define printr64(reg) printf("%15.15s: %016lx\n",#reg,GET_U64(reg))
 
-    char buff[256];
     //    printr("FwVersion       : %08x\n",_private->device->fwVersion);
     printr  (NBeamSeq);
     printr  (NControlSeq);
@@ -451,15 +512,14 @@ namespace TPGen {
     printr  (IrqStatus);
     printrn (BeamEnergy,4);
     { printf("%15.15s:","MpsLink");
-      Path pgp_path = _private->root->findByName("mmio/AmcCarrierTimingGenerator/ApplicationCore/TPGMps/Pgp2bAxi/");
-      printf(" RxRdy[%c]", _GET_U32("PhyReadyRx",pgp_path) ? 'T':'F');
-      printf(" TxRdy[%c]", _GET_U32("PhyReadyTx",pgp_path) ? 'T':'F');
-      printf(" LocRdy[%c]", _GET_U32("LocalLinkReady",pgp_path) ? 'T':'F');
-      printf(" RemRdy[%c]", _GET_U32("RemoteLinkReady",pgp_path) ? 'T':'F');
-      printf(" RxClkF[%u]", _GET_U32("RxClockFreq",pgp_path));
-      printf(" TxClkF[%u]", _GET_U32("TxClockFreq",pgp_path));
-      printf(" RxFrameCnt[%u]", _GET_U32("RxFrameCnt",pgp_path));
-      printf(" RxFrameErr[%u]", _GET_U32("RxFrameErrCnt",pgp_path));
+      printf(" RxRdy[%c]", GET_U32(MpsPhyReadyRx) ? 'T':'F');
+      printf(" TxRdy[%c]", GET_U32(MpsPhyReadyTx) ? 'T':'F');
+      printf(" LocRdy[%c]", GET_U32(MpsLocalLinkReady) ? 'T':'F');
+      printf(" RemRdy[%c]", GET_U32(MpsRemoteLinkReady) ? 'T':'F');
+      printf(" RxClkF[%u]", GET_U32(MpsRxClockFreq));
+      printf(" TxClkF[%u]", GET_U32(MpsTxClockFreq));
+      printf(" RxFrameCnt[%u]", GET_U32(MpsRxFrameCnt));
+      printf(" RxFrameErr[%u]", GET_U32(MpsRxFrameErrCnt));
       printf("\n"); }
     { printf("%15.15s:","MpsState(Latch)");
       IndexRange rng(0);
@@ -491,8 +551,10 @@ namespace TPGen {
     printrs (CountBRT);
     printrsn(CountTrig,12);
     printf("%15.15s:","ProgCount: ");
-    for(unsigned i=0; i<8; i++)
-      printf(" %09u", const_cast<TPGYaml*>(this)->getCounter(i));
+    { uint32_t counts[8];
+      const_cast<TPGYaml*>(this)->getCounters(counts,8);
+      for(unsigned i=0; i<8; i++)
+        printf(" %09u", counts[i]); }
     printf("\n");
 
     unsigned nAllowEng = nAllowEngines();
@@ -511,24 +573,20 @@ namespace TPGen {
     { 
       for(unsigned i=0; i<nAllowEng; i++) {
         printf("%11.11s[%02d]:","SeqJump",i);
-        sprintf(buff,"TPGSeqJump/StartAddr[%u]/MemoryArray",i);
-        ScalVal_RO r = IScalVal::create(_private->tpg->findByName(buff));
-        IndexRange rng(0);
-        for(unsigned j=0; j<16; j++, ++rng) {
-          unsigned a;
-          r->getVal(&a,1,&rng);
-          printf(" %04x", a);
+        unsigned a[NSEQJUMPADDR];
+        IndexRange rng(i*NSEQJUMPADDR,(i+1)*NSEQJUMPADDR-1);
+        GET_REGV(SeqJumpStartAddr,a,NSEQJUMPADDR,&rng);
+        for(unsigned j=0; j<NSEQJUMPADDR; j++) {
+          printf(" %04x", a[j]);
         }
         printf("\n");
       }
       for(unsigned i=nAllowEng; i<nAllowEng+nBeamEng+nCtrlEng; i+=16) {
         printf("%11.11s[%02d:%02d]:","SeqJump",i,i+15);
         for(unsigned j=0; j<16 && (i+j)<nAllowEng+nBeamEng+nCtrlEng; j++) {
-          sprintf(buff,"TPGSeqJump/StartAddr[%u]/MemoryArray",i+j);
-          ScalVal_RO r = IScalVal::create(_private->tpg->findByName(buff));
-          IndexRange rng(15);
           unsigned a;
-          r->getVal(&a,1,&rng);
+          IndexRange rng((i+j)*NSEQJUMPADDR+15);
+          GET_REGV(SeqJumpStartAddr,&a,1,&rng);
           printf(" %04x", a);
         }
         printf("\n");
@@ -539,45 +597,47 @@ namespace TPGen {
   void TPGYaml::dump_rcvr(unsigned n) {
   }
 
-  void TPGYaml::force_sync() { CPSW_TRY_CATCH( SET_U32(GenStatus,1) ); }
+  void TPGYaml::force_sync() { TPG_API; CPSW_TRY_CATCH( SET_U32(GenStatus,1) ); }
  
   void TPGYaml::reset_xbar()
   {
+    TPG_API;
     unsigned v=1;  // from FPGA
-    for(unsigned i=0; i<4; i++) {
+    for(unsigned i=0; i<Cphw::Regs::AxiSy56040::OutputConfig.nelms; i++) {
       IndexRange rng(i);
-      CPSW_TRY_CATCH( IScalVal::create(_private->root->findByName("mmio/AmcCarrierTimingGenerator/AmcCarrierCore/AxiSy56040/OutputConfig"))->setVal(&v,1,&rng) );
+      CPSW_TRY_CATCH( _SET(_private->xbar,Cphw::Regs::AxiSy56040::OutputConfig,&v,1,&rng) );
     }
   }
 
   void TPGYaml::reset_jesdRx()
   {
+    TPG_API;
       unsigned zero(0), one(1);
-      CPSW_TRY_CATCH( IScalVal::create(_private->root->findByName("mmio/AmcCarrierTimingGenerator/ApplicationCore/AppTopJesd/JesdRx/ResetGTs"))->setVal(one));
-      CPSW_TRY_CATCH( IScalVal::create(_private->root->findByName("mmio/AmcCarrierTimingGenerator/ApplicationCore/AppTopJesd/JesdRx/ResetGTs"))->setVal(zero));
+      CPSW_TRY_CATCH( SET_REGV(JesdResetGTs,&one));
+      CPSW_TRY_CATCH( SET_REGV(JesdResetGTs,&zero));
   }
 
   void TPGYaml::setSequenceRequired(unsigned iseq, unsigned requiredMask) 
   {
+    TPG_API;
     //  Firmware wants index to start at beginning of beam sequence engines
     if (iseq < nAllowEngines())
       return;
     iseq -= nAllowEngines();
     if (iseq < nBeamEngines()) {
-      IndexRange rng(iseq);
-      CPSW_TRY_CATCH( IScalVal::create(_private->tpg->findByName("TPGControl/BeamSeqAllowMask"))->setVal(&requiredMask,1,&rng) );
+      CPSW_TRY_CATCH( SET_U32I(BeamSeqAllowMask,requiredMask,iseq) );
     }
   }
 
   void TPGYaml::setSequenceDestination(unsigned iseq, TPGDestination destn) 
   {
+    TPG_API;
     //  Firmware wants index to start at beginning of beam sequence engines
     if (iseq < nAllowEngines())
       return;
     iseq -= nAllowEngines();
     if (iseq < nBeamEngines()) {
-      IndexRange rng(iseq);
-      CPSW_TRY_CATCH( IScalVal::create(_private->tpg->findByName("TPGControl/BeamSeqDestination"))->setVal(&destn,1,&rng) );
+      CPSW_TRY_CATCH( SET_U32I(BeamSeqDestination,destn,iseq) );
     }
   }
 
@@ -596,6 +656,7 @@ namespace TPGen {
 
   void TPGYaml::resetSequences(const std::list<unsigned>& l)
   {
+    TPG_API;
     uint32_t v[4];
     memset(v,0,sizeof(v));
     for(std::list<unsigned>::const_iterator it=l.begin();
@@ -603,39 +664,35 @@ namespace TPGen {
       v[*it/32] |= 1ULL<<(*it % 32);
 
     { IndexRange rng(0,3);
-      IScalVal::create( _private->tpg->findByName("TPGControl/SeqRestart"))->setVal(v,4,&rng); }
+      SET_REGV(SeqRestart,v,4,&rng); }
 
     { IndexRange rng(0);
-      IScalVal::create( _private->tpg->findByName("TPGControl/SeqRestartGo"))->setVal(v,1,&rng); }
+      SET_REGV(SeqRestartGo,v,1,&rng); }
   }
 
-  unsigned TPGYaml::getDiagnosticSequence() const  { unsigned u; CPSW_TRY_CATCH( u = GET_U32(DiagSeq) ); return u; }
+  unsigned TPGYaml::getDiagnosticSequence() const  { TPG_API; unsigned u; CPSW_TRY_CATCH( u = GET_U32(DiagSeq) ); return u; }
 
-  void     TPGYaml::setDiagnosticSequence(unsigned v) { CPSW_TRY_CATCH( SET_U32(DiagSeq,v) ); }
+  void     TPGYaml::setDiagnosticSequence(unsigned v) { TPG_API; CPSW_TRY_CATCH( SET_U32(DiagSeq,v) ); }
 
   unsigned TPGYaml::getBeamDiagDestinationMask(unsigned engine) const { 
+    TPG_API;
     unsigned u; 
-    char buff[256];
-    sprintf(buff,"DestDiagControl[%u]/DestMask",engine);
-    CPSW_TRY_CATCH( u = _GET_U32(buff, _private->core) );
+    CPSW_TRY_CATCH( u = GET_U32I(DestDiagMask, engine) );
     return u; }
 
   unsigned TPGYaml::getBeamDiagInterval(unsigned engine, unsigned index) const {
+    TPG_API;
     unsigned u; 
-    char buff[256];
-    sprintf(buff,"DestDiagControl[%u]/Interval",engine);
-    CPSW_TRY_CATCH( u = _GET_U32(buff, _private->core, index) );
+    CPSW_TRY_CATCH( u = GET_U32I(DestDiagInterval, engine*NDESTDIAGINTV+index) );
     return u; }
 
   void TPGYaml::setBeamDiagDestinationMask(unsigned engine, unsigned mask) {
-    char buff[256];
-    sprintf(buff,"DestDiagControl[%u]/DestMask",engine);
-    CPSW_TRY_CATCH(_SET_U32(buff, _private->core, mask) ); }
+    TPG_API;
+    CPSW_TRY_CATCH( SET_U32I(DestDiagMask, mask, engine) ); }
   
   void TPGYaml::setBeamDiagInterval(unsigned engine, unsigned index, unsigned interval) {
-    char buff[256];
-    sprintf(buff,"DestDiagControl[%u]/Interval[%u]",engine,index);
-    CPSW_TRY_CATCH( _SET_U32(buff, _private->core, interval) );
+    TPG_API;
+    CPSW_TRY_CATCH( SET_U32I(DestDiagInterval, interval, engine*NDESTDIAGINTV+index) );
   }
 
   int  TPGYaml::startBSA            (unsigned array,
@@ -650,18 +707,18 @@ namespace TPGen {
                                      EventSelection* selection,
                                      unsigned maxSevr)
   {
+    TPG_API;
     int result=0;
 
     if (array < nArraysBSA()) {
       if (nToAverage <= MAXAVGBSA) {
 	if (avgToAcquire <= MAXACQBSA) {
-          IndexRange rng(array);
           unsigned v = selection->word();
-          CPSW_TRY_CATCH( IScalVal::create(_private->tpg->findByName("TPGControl/BsaEventSel"))->setVal(&v,1,&rng) );
+          CPSW_TRY_CATCH( SET_U32I(BsaEventSel,v,array) );
           v = (nToAverage&0x1fff) | 
             ((maxSevr&3)<<14) |
 	    (avgToAcquire<<16);
-          CPSW_TRY_CATCH( IScalVal::create(_private->tpg->findByName("TPGControl/BsaStatSel"))->setVal(&v,1,&rng) );
+          CPSW_TRY_CATCH( SET_U32I(BsaStatSel,v,array) );
 	}
 	else result = -3;
       }
@@ -676,86 +733,115 @@ namespace TPGen {
 
   void TPGYaml::stopBSA             (unsigned array)
   {
-    IndexRange rng(array);
-    unsigned v=0;
-    CPSW_TRY_CATCH( IScalVal::create(_private->tpg->findByName("TPGControl/BsaEventSel"))->setVal(&v,1,&rng) );
+    TPG_API;
+    CPSW_TRY_CATCH( SET_U32I(BsaEventSel,0,array) );
   }
 
   void TPGYaml::queryBSA            (unsigned  array,
                                      unsigned& nToAverage,
                                      unsigned& avgToAcquire)
   {
-    IndexRange rng(array);
+    TPG_API;
     unsigned v;
-    CPSW_TRY_CATCH( IScalVal_RO::create(_private->tpg->findByName("TPGStatus/BsaStatus"))->getVal(&v,1,&rng) );
+    CPSW_TRY_CATCH( v = GET_U32I(BsaStatus,array) );
     nToAverage   = v & 0xffff;
     avgToAcquire = v >> 16; 
   }
 
   uint64_t TPGYaml::bsaComplete()
   {
+    TPG_API;
     uint64_t v;
-    CPSW_TRY_CATCH( _private->bsaComplete->getVal(&v,1) );
+    CPSW_TRY_CATCH( v = GET_U64(BsaComplete) );
     return v;
   }
 
   void TPGYaml::bsaComplete(uint64_t ack)
   {
+    TPG_API;
     CPSW_TRY_CATCH( SET_REG(BsaComplete, ack) );
   }
 
   std::map<unsigned,uint64_t> TPGYaml::getBSATimestamps() const
   {
+    TPG_API;
     unsigned nts = nArraysBSA();
     std::map<unsigned,uint64_t> ts;
     IndexRange rng(0,nts-1);
     uint64_t v[64];
-    CPSW_TRY_CATCH( _private->bsaTimestamp->getVal(v,nts,&rng) );
+    CPSW_TRY_CATCH( GET_REGV(BsaTimestamp,v,nts,&rng) );
     for(unsigned i=0; i<nts; i++) {
       ts[i] = v[i];
     }
     return ts;
   }
   
-  void TPGYaml::setCountInterval(unsigned v) { SET_U32S(CountIntv,v); }
+  void TPGYaml::setCountInterval(unsigned v) { TPG_API; SET_U32(CountIntv,v); }
   
-  unsigned TPGYaml::getPLLchanges   () const { unsigned u; CPSW_TRY_CATCH( u = GET_U32S(CountPLL) ); return u; }
-  unsigned TPGYaml::get186Mticks    () const { unsigned u; CPSW_TRY_CATCH( u = GET_U32S(Count186M) ); return u; }
-  unsigned TPGYaml::getSyncErrors   () const { unsigned u; CPSW_TRY_CATCH( u = GET_U32S(CountSyncE) ); return u; }
-  unsigned TPGYaml::getCountInterval() const { unsigned u; CPSW_TRY_CATCH( u = GET_U32S(CountIntv) ); return u; }
-  unsigned TPGYaml::getBaseRateTrigs() const { unsigned u; CPSW_TRY_CATCH( u = GET_U32S(CountBRT) ); return u; }
-  unsigned TPGYaml::getInputTrigs   (unsigned ch) const { unsigned u; CPSW_TRY_CATCH( u = GET_U32SI(CountTrig,ch) ); return u;}
+  unsigned TPGYaml::getPLLchanges   () const { TPG_API; unsigned u; CPSW_TRY_CATCH( u = GET_U32(CountPLL) ); return u; }
+  unsigned TPGYaml::get186Mticks    () const { TPG_API; unsigned u; CPSW_TRY_CATCH( u = GET_U32(Count186M) ); return u; }
+  unsigned TPGYaml::getSyncErrors   () const { TPG_API; unsigned u; CPSW_TRY_CATCH( u = GET_U32(CountSyncE) ); return u; }
+  unsigned TPGYaml::getCountInterval() const { TPG_API; unsigned u; CPSW_TRY_CATCH( u = GET_U32(CountIntv) ); return u; }
+  unsigned TPGYaml::getBaseRateTrigs() const { TPG_API; unsigned u; CPSW_TRY_CATCH( u = GET_U32(CountBRT) ); return u; }
+  unsigned TPGYaml::getInputTrigs   (unsigned ch) const { TPG_API; unsigned u; CPSW_TRY_CATCH( u = GET_U32I(CountTrig,ch) ); return u;}
   unsigned TPGYaml::getSeqRequests  (unsigned seq) const { return getSeqRequests(seq,0); }
   unsigned TPGYaml::getSeqRequests  (unsigned seq, unsigned bit) const { 
-    IndexRange rng(seq*4+bit);
+    TPG_API;
     unsigned v;
-    CPSW_TRY_CATCH(IScalVal_RO::create(_private->tpg->findByName("TPGStatus/CountSeq"))->getVal(&v,1,&rng));
+    CPSW_TRY_CATCH( v = GET_U32I(CountSeq,seq*4+bit) );
     return v;
   }
   unsigned TPGYaml::getSeqRequests  (unsigned* array, unsigned array_size) const { 
-    CPSW_TRY_CATCH(IScalVal_RO::create(_private->tpg->findByName("TPGStatus/CountSeq"))->getVal(array,array_size));
+    TPG_API;
+    CPSW_TRY_CATCH( GET_REGV(CountSeq,array,array_size) );
     return array_size;
   }
-  unsigned TPGYaml::getSeqRateRequests  (unsigned seq) const { unsigned u; CPSW_TRY_CATCH( u = _GET_U32("DestRate/Destn",_private->core,seq) ); return u;}
+  unsigned TPGYaml::getSeqRateRequests  (unsigned seq) const { TPG_API; unsigned u; CPSW_TRY_CATCH( u = GET_U32I(DestnRate,seq) ); return u;}
   unsigned TPGYaml::getSeqRateRequests  (unsigned* array, unsigned array_size) const
-  { unsigned n = array_size;
-    CPSW_TRY_CATCH( IScalVal_RO::create(_private->core->findByName("DestnRate/Destn"))->getVal(array,n) );
+  { TPG_API; unsigned n = array_size;
+    CPSW_TRY_CATCH( GET_REGV(DestnRate,array,n) );
     return n;
   }
 
-  void     TPGYaml::lockCounters    (bool q) { CPSW_TRY_CATCH( SET_U32(CounterLock,(q?1:0)) ); }
+  void     TPGYaml::lockCounters    (bool q) { TPG_API; CPSW_TRY_CATCH( SET_U32(CounterLock,(q?1:0)) ); }
   void     TPGYaml::setCounter      (unsigned i, EventSelection* s)
   {
-    IndexRange rng(i);
-    unsigned v = s->word();
-    CPSW_TRY_CATCH( IScalVal::create(_private->tpg->findByName("TPGControl/CounterDef"))->setVal(&v,1,&rng) );
+    TPG_API;
+    CPSW_TRY_CATCH( SET_U32I(CounterDef,s->word(),i) );
   }
-  unsigned TPGYaml::getCounter      (unsigned i) { unsigned u; CPSW_TRY_CATCH( u = GET_U32I(CounterDef,i) ); return u; }
+  void     TPGYaml::setCounters     (const uint32_t* words, unsigned n)
+  {
+    TPG_API;
+    if (n > NRATECOUNTERS)
+      n = NRATECOUNTERS;
+    IndexRange rng(0,n-1);
+    CPSW_TRY_CATCH( SET_REGV(CounterDef,const_cast<uint32_t*>(words),n,&rng) );
+  }
+  void     TPGYaml::getCounters     (uint32_t* counts, unsigned n)
+  {
+    TPG_API;
+    if (n > NRATECOUNTERS)
+      n = NRATECOUNTERS;
+    unsigned one(1), zero(0);
+    IndexRange rng(0,n-1);
+    CPSW_TRY_CATCH( SET_REG(CounterLock,one) );
+    try {
+      GET_REGV(CounterDef,counts,n,&rng);
+    } catch (CPSWError& e) {
+      SET_REG(CounterLock,zero);
+      fprintf(stderr,"CPSW Error: %s at %s, line %d\n",
+              e.getInfo().c_str(), __FILE__, __LINE__);
+      throw e;
+    }
+    CPSW_TRY_CATCH( SET_REG(CounterLock,zero) );
+  }
+  unsigned TPGYaml::getCounter      (unsigned i) { TPG_API; unsigned u; CPSW_TRY_CATCH( u = GET_U32I(CounterDef,i) ); return u; }
 
   void     TPGYaml::getMpsState     (unsigned  destination, 
                                      unsigned& latch, 
                                      unsigned& state) 
   {
+    TPG_API;
     unsigned a;
     CPSW_TRY_CATCH( a = GET_U8I(MpsState,destination) );
     latch = a&0xf;
@@ -771,21 +857,21 @@ namespace TPGen {
                                        unsigned& rxFrameErrorCount,
                                        unsigned& rxFrameCount)
   {
-    Path _path = _private->root->findByName("mmio/AmcCarrierTimingGenerator/ApplicationCore/TPGMps/Pgp2bAxi/");
-    CPSW_TRY_CATCH( IScalVal_RO::create(_path->findByName("PhyReadyRx"))->getVal(&rxRdy,1) );
-    CPSW_TRY_CATCH( IScalVal_RO::create(_path->findByName("PhyReadyTx"))->getVal(&txRdy,1) );
-    CPSW_TRY_CATCH( IScalVal_RO::create(_path->findByName("LocalLinkReady"))->getVal(&locLnkRdy,1) );
-    CPSW_TRY_CATCH( IScalVal_RO::create(_path->findByName("RemoteLinkReady"))->getVal(&remLnkRdy,1) );
-    CPSW_TRY_CATCH( IScalVal_RO::create(_path->findByName("RxClockFreq"))->getVal(&rxClkFreq,1) );
-    CPSW_TRY_CATCH( IScalVal_RO::create(_path->findByName("TxClockFreq"))->getVal(&txClkFreq,1) );
-    CPSW_TRY_CATCH( IScalVal_RO::create(_path->findByName("RxFrameErrCnt"))->getVal(&rxFrameErrorCount,1) );
-    CPSW_TRY_CATCH( IScalVal_RO::create(_path->findByName("RxFrameCnt"))->getVal(&rxFrameCount,1) );
+    TPG_API;
+    CPSW_TRY_CATCH( rxRdy             = GET_U32(MpsPhyReadyRx) );
+    CPSW_TRY_CATCH( txRdy             = GET_U32(MpsPhyReadyTx) );
+    CPSW_TRY_CATCH( locLnkRdy         = GET_U32(MpsLocalLinkReady) );
+    CPSW_TRY_CATCH( remLnkRdy         = GET_U32(MpsRemoteLinkReady) );
+    CPSW_TRY_CATCH( rxClkFreq         = GET_U32(MpsRxClockFreq) );
+    CPSW_TRY_CATCH( txClkFreq         = GET_U32(MpsTxClockFreq) );
+    CPSW_TRY_CATCH( rxFrameErrorCount = GET_U32(MpsRxFrameErrCnt) );
+    CPSW_TRY_CATCH( rxFrameCount      = GET_U32(MpsRxFrameCnt) );
   }
 
   void     TPGYaml::getTimingFrameRxDiag (unsigned& txClkCount)
   {
-    Path _path = _private->root->findByName("mmio/AmcCarrierTimingGenerator/AmcCarrierCore/AmcCarrierTiming/TimingFrameRx/");
-    CPSW_TRY_CATCH( IScalVal_RO::create(_path->findByName("TxClkCount"))->getVal(&txClkCount, 1) );
+    TPG_API;
+    CPSW_TRY_CATCH( txClkCount = _GET_U32(_private->frameRx, Cphw::Regs::TimingFrameRx::TxClkCount) );
   }
 
   void     TPGYaml::getClockPLLDiag(unsigned& locked,
@@ -793,10 +879,11 @@ namespace TPGen {
                                     unsigned& lockCount,
                                     unsigned& refClockLostCount)
   {
-      CPSW_TRY_CATCH( IScalVal_RO::create(_private->root->findByName("mmio/AmcCarrierTimingGenerator/AmcCarrierCore/AmcCarrierTiming/MonitorCpll/Locked"))->getVal(&locked, 1));
-      CPSW_TRY_CATCH( IScalVal_RO::create(_private->root->findByName("mmio/AmcCarrierTimingGenerator/AmcCarrierCore/AmcCarrierTiming/MonitorCpll/RefclkLost"))->getVal(&refClockLost, 1));
-      CPSW_TRY_CATCH( IScalVal_RO::create(_private->root->findByName("mmio/AmcCarrierTimingGenerator/AmcCarrierCore/AmcCarrierTiming/MonitorCpll/LockCounts"))->getVal(&lockCount, 1));
-      CPSW_TRY_CATCH( IScalVal_RO::create(_private->root->findByName("mmio/AmcCarrierTimingGenerator/AmcCarrierCore/AmcCarrierTiming/MonitorCpll/RefclkLostCounts"))->getVal(&refClockLostCount, 1));
+    TPG_API;
+      CPSW_TRY_CATCH( locked            = GET_U32(CpllLocked) );
+      CPSW_TRY_CATCH( refClockLost      = GET_U32(CpllRefclkLost) );
+      CPSW_TRY_CATCH( lockCount         = GET_U32(CpllLockCounts) );
+      CPSW_TRY_CATCH( refClockLostCount = GET_U32(CpllRefclkLostCounts) );
   }
 
   
@@ -826,7 +913,7 @@ namespace TPGen {
     if (_private->faultCallback   ==cb) _private->faultCallback=0; }
 
   void TPGYaml::enableIrq    (unsigned bit, bool q)
-  { unsigned v;
+  { TPG_API; unsigned v;
     CPSW_TRY_CATCH( v = GET_U32(IrqControl) );
     if (q)
       v |= 1<<bit;
@@ -868,6 +955,7 @@ namespace TPGen {
         usleep(100000);
       }
       else {
+        RegProbe _api(&_private->stats,"TPGYaml","handleIrq");
 
         if (0) {
           timespec tv; clock_gettime(CLOCK_REALTIME,&tv);
@@ -876,6 +964,10 @@ namespace TPGen {
           printf("received irqStatus %x  %f  faultcb %p\n",irqStatus,dt,_private->faultCallback); 
         }
 
+        //  Capture before the callback so it sees this interval's counters
+        if ((irqStatus&(1<<IRQ_INTERVAL)) && _private->captureInterval)
+          _captureInterval();
+
         if ((irqStatus&(1<<IRQ_INTERVAL)) && _private->intervalCallback)
           _private->intervalCallback->routine();
         
@@ -908,7 +1000,7 @@ namespace TPGen {
       }
 
       unsigned irqControl=(1<<IRQ_CHECKPOINT);
-      if (_private->intervalCallback)
+      if (_private->intervalCallback || _private->captureInterval)
         irqControl |= (1<<IRQ_INTERVAL);
       if (_private->bsaCallback.size())
         irqControl |= (1<<IRQ_BSA);
@@ -922,6 +1014,87 @@ namespace TPGen {
     perror("Exited TPGYaml::handleIrq()\n");
   }
 
+  void     TPGYaml::snapshot(TPGSnapshot& s) const
+  {
+    TPG_API;
+    uint64_t ts;
+    CPSW_TRY_CATCH( s.pulseId = GET_U64(PulseId) );
+    CPSW_TRY_CATCH( ts        = GET_U64(TStamp) );
+    s.tsSec  = ts>>32;
+    s.tsNsec = ts&0xffffffff;
+
+    CPSW_TRY_CATCH( s.pllChanges    = GET_U32(CountPLL) );
+    CPSW_TRY_CATCH( s.ticks186M     = GET_U32(Count186M) );
+    CPSW_TRY_CATCH( s.syncErrors    = GET_U32(CountSyncE) );
+    CPSW_TRY_CATCH( s.countInterval = GET_U32(CountIntv) );
+    CPSW_TRY_CATCH( s.baseRateTrigs = GET_U32(CountBRT) );
+    { IndexRange rng(0,TPGSnapshot::NINPUTTRIGS-1);
+      CPSW_TRY_CATCH( GET_REGV(CountTrig,s.inputTrigs,TPGSnapshot::NINPUTTRIGS,&rng) ); }
+    { IndexRange rng(0,TPGSnapshot::NMPSDESTNS-1);
+      CPSW_TRY_CATCH( GET_REGV(MpsState,s.mpsState,TPGSnapshot::NMPSDESTNS,&rng) ); }
+
+    CPSW_TRY_CATCH( s.faultCounts = GET_U32(BeamDiagCount) );
+    { IndexRange rng(0,TPGSnapshot::NBEAMDIAG-1);
+      CPSW_TRY_CATCH( GET_REGV(BeamDiagStatus,s.beamDiagStatus,TPGSnapshot::NBEAMDIAG,&rng) ); }
+
+    CPSW_TRY_CATCH( s.mpsRxRdy           = GET_U32(MpsPhyReadyRx) );
+    CPSW_TRY_CATCH( s.mpsTxRdy           = GET_U32(MpsPhyReadyTx) );
+    CPSW_TRY_CATCH( s.mpsLocLnkRdy       = GET_U32(MpsLocalLinkReady) );
+    CPSW_TRY_CATCH( s.mpsRemLnkRdy       = GET_U32(MpsRemoteLinkReady) );
+    CPSW_TRY_CATCH( s.mpsRxClkFreq       = GET_U32(MpsRxClockFreq) );
+    CPSW_TRY_CATCH( s.mpsTxClkFreq       = GET_U32(MpsTxClockFreq) );
+    CPSW_TRY_CATCH( s.mpsRxFrameErrCount = GET_U32(MpsRxFrameErrCnt) );
+    CPSW_TRY_CATCH( s.mpsRxFrameCount    = GET_U32(MpsRxFrameCnt) );
+
+    CPSW_TRY_CATCH( s.pllLocked            = GET_U32(CpllLocked) );
+    CPSW_TRY_CATCH( s.pllRefClockLost      = GET_U32(CpllRefclkLost) );
+    CPSW_TRY_CATCH( s.pllLockCount         = GET_U32(CpllLockCounts) );
+    CPSW_TRY_CATCH( s.pllRefClockLostCount = GET_U32(CpllRefclkLostCounts) );
+
+    CPSW_TRY_CATCH( s.txClkCount = _GET_U32(_private->frameRx, Cphw::Regs::TimingFrameRx::TxClkCount) );
+  }
+
+  void     TPGYaml::enableIntervalCapture(bool q)
+  {
+    _private->captureInterval = q;
+    if (q)
+      enableIrq(IRQ_INTERVAL,true);
+  }
+
+  unsigned TPGYaml::intervalCounters(TPGIntervalCounters& c) const
+  {
+    pthread_mutex_lock(&_private->intervalLock);
+    c = _private->interval[_private->intervalFront];
+    pthread_mutex_unlock(&_private->intervalLock);
+    return c.seq;
+  }
+
+  void     TPGYaml::_captureInterval()
+  {
+    TPG_API;
+    unsigned back = _private->intervalFront^1;
+    TPGIntervalCounters& c = _private->interval[back];
+    CPSW_TRY_CATCH( c.pulseId       = GET_U64(PulseId) );
+    CPSW_TRY_CATCH( c.countInterval = GET_U32(CountIntv) );
+    CPSW_TRY_CATCH( c.baseRateTrigs = GET_U32(CountBRT) );
+    { IndexRange rng(0,TPGIntervalCounters::NINPUTTRIGS-1);
+      CPSW_TRY_CATCH( GET_REGV(CountTrig,c.inputTrigs,TPGIntervalCounters::NINPUTTRIGS,&rng) ); }
+    { IndexRange rng(0,TPGIntervalCounters::NRATECOUNTERS-1);
+      CPSW_TRY_CATCH( GET_REGV(CounterDef,c.rateCounters,TPGIntervalCounters::NRATECOUNTERS,&rng) ); }
+    if (c.seqRequests.size()) {
+      IndexRange rng(0,c.seqRequests.size()-1);
+      CPSW_TRY_CATCH( GET_REGV(CountSeq,c.seqRequests.data(),c.seqRequests.size(),&rng) );
+    }
+
+    pthread_mutex_lock(&_private->intervalLock);
+    c.seq = _private->interval[_private->intervalFront].seq+1;
+    _private->intervalFront = back;
+    pthread_mutex_unlock(&_private->intervalLock);
+  }
+
+  Cphw::RegStats& TPGYaml::regStats()
+  { return _private->stats; }
+
   void TPGYaml::setL1Trig(unsigned index,
 			     unsigned evcode,
 			     unsigned delay)
@@ -934,8 +1107,6 @@ namespace TPGen {
 
   void TPGYaml::_dumpSeqState(unsigned seq0, unsigned nseq) const
   {
-    char buff[256];
-
     { printf("%15.15s:","CountSeq");
       /*
       unsigned* seqcount = new unsigned[(seq0+nseq)*4];
@@ -961,14 +1132,12 @@ namespace TPGen {
     { printf("%15.15s:","SeqState");
       unsigned i=seq0;
       for(unsigned j=0; j<nseq; i++,j++) {
-        sprintf(buff,"TPGSeqState/SeqIndex[%u]",i);
-        printf(" %8u",_GET_U32(buff,_private->tpg));
-        IndexRange rng(i);
+        printf(" %8u",GET_U32I(SeqIndex,i));
         unsigned cc[4];
-        IScalVal_RO::create(_private->tpg->findByName("TPGSeqState/SeqCondACount"))->getVal(&cc[0],1,&rng);
-        IScalVal_RO::create(_private->tpg->findByName("TPGSeqState/SeqCondBCount"))->getVal(&cc[1],1,&rng);
-        IScalVal_RO::create(_private->tpg->findByName("TPGSeqState/SeqCondCCount"))->getVal(&cc[2],1,&rng);
-        IScalVal_RO::create(_private->tpg->findByName("TPGSeqState/SeqCondDCount"))->getVal(&cc[3],1,&rng);
+        cc[0] = GET_U32I(SeqCondACount,i);
+        cc[1] = GET_U32I(SeqCondBCount,i);
+        cc[2] = GET_U32I(SeqCondCCount,i);
+        cc[3] = GET_U32I(SeqCondDCount,i);
         printf(" :%u:%u:%u:%u",cc[0],cc[1],cc[2],cc[3]);
         if ((j%3)==2)
           printf("\n                ");
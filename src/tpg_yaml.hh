@@ -22,8 +22,67 @@
 
 #include "tpg.hh"
 
+namespace Cphw { class RegStats; };
+
 namespace TPGen {
 
+  //
+  //  Monitor-class registers read together by TPGYaml::snapshot()
+  //
+  class TPGSnapshot {
+  public:
+    enum { NINPUTTRIGS=12, NMPSDESTNS=16, NBEAMDIAG=4 };
+  public:
+    uint64_t  pulseId;            // TPG pulse ID when the snapshot began
+    unsigned  tsSec;              // TPG timestamp when the snapshot began
+    unsigned  tsNsec;
+    //  TPGStatus
+    unsigned  pllChanges;
+    unsigned  ticks186M;
+    unsigned  syncErrors;
+    unsigned  countInterval;
+    unsigned  baseRateTrigs;
+    unsigned  inputTrigs[NINPUTTRIGS];
+    //  MPS state: latch (3:0), state (7:4)
+    uint8_t   mpsState[NMPSDESTNS];
+    //  Beam diagnostic history buffers
+    unsigned  faultCounts;
+    unsigned  beamDiagStatus[NBEAMDIAG];
+    //  MPS link
+    unsigned  mpsRxRdy;
+    unsigned  mpsTxRdy;
+    unsigned  mpsLocLnkRdy;
+    unsigned  mpsRemLnkRdy;
+    unsigned  mpsRxClkFreq;
+    unsigned  mpsTxClkFreq;
+    unsigned  mpsRxFrameErrCount;
+    unsigned  mpsRxFrameCount;
+    //  Timing clock PLL
+    unsigned  pllLocked;
+    unsigned  pllRefClockLost;
+    unsigned  pllLockCount;
+    unsigned  pllRefClockLostCount;
+    //  TimingFrameRx
+    unsigned  txClkCount;
+  };
+
+  //
+  //  Counters latched by the firmware at the end of each count interval
+  //  and captured once per IRQ_INTERVAL by the interrupt handler
+  //
+  class TPGIntervalCounters {
+  public:
+    enum { NINPUTTRIGS=12, NRATECOUNTERS=24 };
+  public:
+    unsigned  seq;                // capture number; 0 until the first interval
+    uint64_t  pulseId;            // pulse ID read at capture
+    unsigned  countInterval;      // interval length [186M clocks]
+    unsigned  baseRateTrigs;
+    unsigned  inputTrigs  [NINPUTTRIGS];
+    unsigned  rateCounters[NRATECOUNTERS];
+    std::vector<unsigned> seqRequests;  // CountSeq, 4 per sequence engine
+  };
+
   class TPGYaml : public TPG {
   public:
     TPGYaml(Path root, bool initialize=true);
@@ -123,6 +182,10 @@ namespace TPGen {
     void     lockCounters    (bool);
     void     setCounter      (unsigned, EventSelection*);
     unsigned getCounter      (unsigned);
+    //  Whole-bank access: one ranged write of n definitions, and
+    //  lock, one ranged read of n counts, unlock
+    void     setCounters     (const uint32_t* words, unsigned n);
+    void     getCounters     (uint32_t* counts, unsigned n);
 
     //  MPS
     void     getMpsState     (unsigned  destination, 
@@ -143,6 +206,16 @@ namespace TPGen {
                              unsigned& lockedCount,
                              unsigned& refClockLostCount);
 
+    //  Capture the latched counters on every IRQ_INTERVAL
+    void     enableIntervalCapture(bool);
+    //  Copy the latest capture without accessing the hardware;
+    //  returns its sequence number (0 if none yet)
+    unsigned intervalCounters(TPGIntervalCounters&) const;
+
+    //  All of the above monitor registers in one pass; arrays are read
+    //  with a single ranged transfer each
+    void     snapshot(TPGSnapshot&) const;
+
     //  Power line sampling ADC
     void     initADC         ();
 
@@ -160,6 +233,8 @@ namespace TPGen {
     //  Diagnostics
     void dump() const;
     void dump_rcvr(unsigned n);
+    //  Register transaction statistics; disabled until regStats().enable(true)
+    Cphw::RegStats& regStats();
 #if 0  // No longer implemented; use beam diagnostic buffers
     void dumpFIFO(unsigned nfifo) const;
     void reset_fifo(unsigned b=0x100,
@@ -174,6 +249,7 @@ namespace TPGen {
     void handleIrq ();
   private:
     void enableIrq (unsigned,bool);
+    void _captureInterval();
     void _dumpSeqState(unsigned,unsigned) const;
   protected:
     class PrivateData;
@@ -8,9 +8,14 @@
 // the terms contained in the LICENSE.txt file.
 //////////////////////////////////////////////////////////////////////////////
 #include "tpr.hh"
+#include "frame.hh"
 
 #include <unistd.h>
 #include <stdio.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 using namespace Tpr;
 
@@ -263,55 +268,111 @@ void RingB::dump(const char* fmt) const
 }
 void RingB::dumpFrames() const
 {
-#define print_u16 {                             \
-    volatile uint32_t v  = (data[j++]<<16);     \
-    printf("%8x ",v);                           \
-  }
-#define print_u32 {                             \
-    volatile uint32_t v  = (data[j++]<<16);     \
-    v = (v>>16) | (data[j++]<<16);              \
-    printf("%8x ",v);                           \
-  }
-#define print_u32be {                           \
-    volatile uint32_t v  = (data[j++]&0xffff);  \
-    v = (v<<16) | (data[j++]&0xffff);           \
-    printf("%8x ",v);                           \
-  }
-#define print_u64 {                             \
-    uint64_t v  = (uint64_t(data[j++])<<48);    \
-    v = (v>>16) | (uint64_t(data[j++])<<48);    \
-    v = (v>>16) | (uint64_t(data[j++])<<48);    \
-    v = (v>>16) | (uint64_t(data[j++])<<48);    \
-    printf("%16lx ",v);                         \
-  }
+  std::vector<RingFrame> f;
+  frames(f);
+
   printf("%8.8s %16.16s %16.16s %8.8s %8.8s %16.16s %16.16s %16.16s %16.16s\n",
          "Version","PulseID","TimeStamp","Markers","BeamReq",
          "BsaInit","BsaActiv","BsaAvgD","BsaDone");
-  unsigned i=0;
-  while(i<0x1fff) {
-    if (data[i]==0x1b5f7) {  // Start of frame
-      if (i+80 >= 0x1fff)
-        break;
-      unsigned j=i+2;
-      print_u16; // version
-      print_u64; // pulse ID
-      print_u64; // time stamp
-      print_u32; // rates/timeslot
-      print_u32; // beamreq
-      j += 12;
-      print_u64; // bsainit
-      print_u64; // bsaactive
-      print_u64; // bsaavgdone
-      print_u64; // bsadone
-      printf("\n");
-      i += 80;
-    }
-    else
-      i++;
+  for(unsigned i=0; i<f.size(); i++)
+    printf("%8x %16llx %16llx %8x %8x %16llx %16llx %16llx %16llx\n",
+           f[i].version,
+           (unsigned long long)f[i].pulseId,
+           (unsigned long long)f[i].timeStamp_seconds<<32 | f[i].timeStamp_nanoseconds,
+           unsigned(f[i].acTimeslot)<<16 | f[i].rates,
+           f[i].beamReq,
+           (unsigned long long)f[i].bsaInit,
+           (unsigned long long)f[i].bsaActive,
+           (unsigned long long)f[i].bsaAvgDone,
+           (unsigned long long)f[i].bsaUpdate);
+}
+
+void RingB::snapshot(uint32_t* buf) const
+{
+  memcpy(buf, const_cast<const uint32_t*>(data), sizeof(data));
+}
+
+unsigned RingB::frames(std::vector<RingFrame>& out) const
+{
+  uint32_t buf[NWORDS];
+  snapshot(buf);
+  out.resize(NWORDS/FRAMEWORDS+1);
+  out.resize(decode(buf, NWORDS, out.data(), out.size()));
+  return out.size();
+}
+
+//  Each ring word carries 16 bits of the frame, least significant first
+static inline uint32_t _u32(const uint32_t* p)
+{
+  return (p[0]&0xffff) | (p[1]<<16);
+}
+
+static inline uint64_t _u64(const uint32_t* p)
+{
+  return uint64_t(_u32(p)) | (uint64_t(_u32(p+2))<<32);
+}
+
+//  Index of the next start of frame at or after i; n if none
+static unsigned _findSof(const uint32_t* buf, unsigned i, unsigned n)
+{
+#ifdef __SSE2__
+  const __m128i sof = _mm_set1_epi32(RingB::SOF);
+  for(; i+4 <= n; i+=4) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf+i));
+    int     m = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, sof)));
+    if (m)
+      return i + __builtin_ctz(m);
   }
-#undef print_u32
-#undef print_u32be
-#undef print_u64
+#endif
+  for(; i<n; i++)
+    if (buf[i]==RingB::SOF)
+      return i;
+  return n;
+}
+
+unsigned RingB::decode(const uint32_t* buf, unsigned nwords,
+                       RingFrame* out, unsigned maxFrames)
+{
+  unsigned nf = 0;
+  unsigned i  = 0;
+  while(nf < maxFrames) {
+    i = _findSof(buf, i, nwords);
+    if (i+FRAMEWORDS >= nwords)
+      break;
+    const uint32_t* p = buf+i;
+    RingFrame&      f = out[nf++];
+    f.offset     = i;
+    f.version    = p[2]&0xffff;
+    f.pulseId    = _u64(p+3);
+    uint64_t ts  = _u64(p+7);
+    f.timeStamp_nanoseconds = uint32_t(ts);
+    f.timeStamp_seconds     = uint32_t(ts>>32);
+    uint32_t r   = _u32(p+11);
+    f.rates      = r&0xffff;
+    f.acTimeslot = r>>16;
+    f.beamReq    = _u32(p+13);
+    f.bsaInit    = _u64(p+27);
+    f.bsaActive  = _u64(p+31);
+    f.bsaAvgDone = _u64(p+35);
+    f.bsaUpdate  = _u64(p+39);
+    i += FRAMEWORDS;
+  }
+  return nf;
+}
+
+void RingFrame::fill(TPGen::Frame& f) const
+{
+  f.vsn[0]                = version;
+  f.pulseId               = pulseId;
+  f.timeStamp_nanoseconds = timeStamp_nanoseconds;
+  f.timeStamp_seconds     = timeStamp_seconds;
+  f.rates                 = rates;
+  f.acTimeslot            = acTimeslot;
+  f.beamReq               = beamReq;
+  f.bsaInit               = bsaInit;
+  f.bsaActive             = bsaActive;
+  f.bsaAvgDone            = bsaAvgDone;
+  f.bsaUpdate             = bsaUpdate;
 }
 
 
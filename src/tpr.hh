@@ -13,6 +13,11 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string>
+#include <vector>
+
+namespace TPGen {
+  class Frame;
+};
 
 namespace Tpr {
   //
@@ -189,15 +194,49 @@ namespace Tpr {
     volatile uint32_t FrameVersion;
   };
 
+  //
+  //  Timing frame fields decoded from a RingB capture
+  //
+  class RingFrame {
+  public:
+    //  Copy into the matching fields of a full frame
+    void fill(TPGen::Frame&) const;
+  public:
+    uint32_t offset;    // of the start-of-frame in the ring
+    uint16_t version;
+    uint64_t pulseId;
+    uint32_t timeStamp_nanoseconds;
+    uint32_t timeStamp_seconds;
+    uint16_t rates;
+    uint16_t acTimeslot;
+    uint32_t beamReq;
+    uint64_t bsaInit;
+    uint64_t bsaActive;
+    uint64_t bsaAvgDone;
+    uint64_t bsaUpdate;
+  };
+
   class RingB {
+  public:
+    enum { NWORDS     = 0x1fff };
+    enum { SOF        = 0x1b5f7 };  // start of frame (K-char flag | comma)
+    enum { FRAMEWORDS = 80 };
   public:
     void enable(bool l);
     void clear ();
     void dump(const char* fmt="%05x") const;
     void dumpFrames() const;
+  public:
+    //  Copy the ring to buf[NWORDS] in one pass
+    void     snapshot(uint32_t* buf) const;
+    //  Snapshot and decode every whole frame; returns the number decoded
+    unsigned frames  (std::vector<RingFrame>&) const;
+    //  Decode frames from a snapshot of nwords
+    static unsigned decode(const uint32_t* buf, unsigned nwords,
+                           RingFrame* out, unsigned maxFrames);
   public:
     volatile uint32_t csr;
-    volatile uint32_t data[0x1fff];
+    volatile uint32_t data[NWORDS];
   };
 
   class TpgMini {
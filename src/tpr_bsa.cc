@@ -0,0 +1,130 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+//
+//  BsaEngine benchmark.  Pulses are generated with the first EDEFs active
+//  on every pulse and averages closed every nToAverage samples; the rate is
+//  compared with the 929 kHz full machine rate.
+//
+#include <stdio.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <vector>
+
+#include "bsa_engine.hh"
+#include "tprdata.hh"
+
+using namespace Tpr;
+
+static const double FULL_RATE = 1300e6/1400.;
+
+static void usage(const char* p) {
+  printf("Usage: %s [options]\n",p);
+  printf("Options: -c <channels>  : Channels per pulse (default 512)\n");
+  printf("         -e <edefs>     : EDEFs active on each pulse (default 4)\n");
+  printf("         -a <samples>   : nToAverage (default 100)\n");
+  printf("         -n <pulses>    : Pulses to process (default 1000000)\n");
+  printf("         -s             : Scan the channel count for the largest at full rate\n");
+}
+
+static double elapsed(const timespec& t0, const timespec& t1)
+{
+  return double(t1.tv_sec-t0.tv_sec)+1.e-9*double(t1.tv_nsec-t0.tv_nsec);
+}
+
+//  Pulses per second through BsaEngine::channel
+static double run(unsigned nch, unsigned nedef, unsigned navg, unsigned npulses,
+                  bool verbose)
+{
+  BsaEngine engine(nch);
+  for(unsigned i=0; i<nedef; i++)
+    engine.start(i, navg, 0);
+
+  //  A few pulses' worth of values, so the loop is not fed from one line
+  const unsigned NV = 16;
+  std::vector<float> values(NV*nch);
+  for(unsigned i=0; i<values.size(); i++)
+    values[i] = float(rand()%1000)*1.e-3f;
+
+  BsaChannel c;
+  memset(&c, 0, sizeof(c));
+  c.newActive = nedef < 64 ? (1ULL<<nedef)-1 : ~0ULL;
+
+  timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for(unsigned i=0; i<npulses; i++) {
+    c.pulseId   = i;
+    c.timeStamp = i;
+    engine.channel(c, &values[(i%NV)*nch]);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  double dt = elapsed(t0,t1);
+  if (verbose) {
+    printf("Channels %u  EDEFs %u  nToAverage %u : %u results\n",
+           nch, nedef, navg, engine.results(0));
+    printf("Elapsed %f s : %.1f kpulses/s  %.0f ns/pulse  (%.0f%% of full rate)\n",
+           dt, 1.e-3*double(npulses)/dt, 1.e9*dt/double(npulses),
+           100.*double(npulses)/dt/FULL_RATE);
+  }
+  return double(npulses)/dt;
+}
+
+int main(int argc, char** argv) {
+
+  extern char* optarg;
+
+  unsigned nch     = 512;
+  unsigned nedef   = 4;
+  unsigned navg    = 100;
+  unsigned npulses = 1000000;
+  bool     lScan   = false;
+
+  int c;
+  while ( (c=getopt( argc, argv, "c:e:a:n:sh")) != EOF ) {
+    switch(c) {
+    case 'c': nch     = strtoul(optarg,NULL,0); break;
+    case 'e': nedef   = strtoul(optarg,NULL,0); break;
+    case 'a': navg    = strtoul(optarg,NULL,0); break;
+    case 'n': npulses = strtoul(optarg,NULL,0); break;
+    case 's': lScan   = true; break;
+    case 'h':
+    default:
+      usage(argv[0]);
+      return 0;
+    }
+  }
+
+  if (!nch || !nedef || nedef > BsaEngine::NEDEFS) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  if (!lScan) {
+    run(nch, nedef, navg, npulses, true);
+    return 0;
+  }
+
+  //  Bisect on multiples of 4 channels
+  unsigned lo = 0, hi = 4096;
+  while(hi - lo > 4) {
+    unsigned mid = (lo+hi)/8*4;
+    if (run(mid, nedef, navg, npulses, false) >= FULL_RATE)
+      lo = mid;
+    else
+      hi = mid;
+  }
+  printf("EDEFs %u : full rate (%.0f kHz) up to %u channels\n",
+         nedef, 1.e-3*FULL_RATE, lo);
+  return 0;
+}
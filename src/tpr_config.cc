@@ -0,0 +1,306 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "tpr_config.hh"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+static const double CLK_FREQ = 1300e6/7.;
+
+//  Register fields
+static const uint32_t CHAN_CTRL_MASK = 0x7;
+static const uint32_t TRIG_CTRL_MASK = (1U<<31) | (1<<16) | 0xffff;
+static const uint32_t TRIG_POLARITY  = (1<<16);
+static const uint32_t TRIG_ENABLE    = (1U<<31);
+static const uint32_t TRIG_TIME_MASK = 0xfffff;
+static const uint32_t TRIG_TAP_MASK  = 0x3f;
+
+using namespace Tpr;
+
+uint32_t TprConfig::fixedRate(unsigned rate)
+{ return (2<<29) | (0<<11) | (rate&0xf); }
+
+uint32_t TprConfig::acRate   (unsigned rate, unsigned tsmask)
+{ return (2<<29) | (1<<11) | ((tsmask&0x7fe)<<2) | (rate&0x7); }
+
+uint32_t TprConfig::sequence (unsigned seq, unsigned bit)
+{ return (2<<29) | (2<<11) | ((seq&0x1f)<<4) | (bit&0xf); }
+
+uint32_t TprConfig::beam     (unsigned destn)
+{ return (0<<29) | (1<<(13+(destn&0xf))); }
+
+TprConfig::TprConfig()
+{
+  memset(_channel, 0, sizeof(_channel));
+  memset(_trigger, 0, sizeof(_trigger));
+}
+
+TprConfig::TprConfig(const TprBase& base)
+{
+  for(unsigned i=0; i<TprBase::NCHANNELS; i++) {
+    _channel[i].control  = base.channel[i].control & CHAN_CTRL_MASK;
+    _channel[i].evtSel   = base.channel[i].evtSel;
+    _channel[i].bsaDelay = base.channel[i].bsaDelay;
+    _channel[i].bsaWidth = base.channel[i].bsaWidth;
+  }
+  for(unsigned i=0; i<TprBase::NTRIGGERS; i++) {
+    _trigger[i].control  = base.trigger[i].control  & TRIG_CTRL_MASK;
+    _trigger[i].delay    = base.trigger[i].delay    & TRIG_TIME_MASK;
+    _trigger[i].width    = base.trigger[i].width    & TRIG_TIME_MASK;
+    _trigger[i].delayTap = base.trigger[i].delayTap & TRIG_TAP_MASK;
+  }
+}
+
+void TprConfig::setChannel(unsigned i, uint32_t evtSel,
+                           unsigned bsaPresample, unsigned bsaDelay, unsigned bsaWidth)
+{
+  if (i >= TprBase::NCHANNELS)
+    return;
+  _channel[i].evtSel   = evtSel;
+  _channel[i].bsaDelay = (bsaPresample<<20) | bsaDelay;
+  _channel[i].bsaWidth = bsaWidth;
+  _channel[i].control  = bsaWidth ? 7 : 5;
+}
+
+void TprConfig::setTrigger(unsigned i, unsigned source,
+                           double delay_ns, double width_ns, bool polarity)
+{
+  if (i >= TprBase::NTRIGGERS)
+    return;
+  //  Rounded to the nearest tap (clock), so that the ns printed by save()
+  //  come back as the same register values
+  uint64_t taps = llround(delay_ns*CLK_FREQ*1.e-9*63);
+  _trigger[i].delay    = unsigned(taps/63) & TRIG_TIME_MASK;
+  _trigger[i].delayTap = unsigned(taps%63) & TRIG_TAP_MASK;
+  _trigger[i].width    = unsigned(llround(width_ns*CLK_FREQ*1.e-9)) & TRIG_TIME_MASK;
+  _trigger[i].control  = (source&0xffff) | (polarity ? TRIG_POLARITY : 0) | TRIG_ENABLE;
+}
+
+bool TprConfig::operator==(const TprConfig& o) const
+{
+  for(unsigned i=0; i<TprBase::NCHANNELS; i++) {
+    bool e = _channel[i].control&1;
+    if (e != bool(o._channel[i].control&1) ||
+        (e && !(_channel[i]==o._channel[i])))
+      return false;
+  }
+  for(unsigned i=0; i<TprBase::NTRIGGERS; i++) {
+    bool e = _trigger[i].enabled();
+    if (e != o._trigger[i].enabled() ||
+        (e && !(_trigger[i]==o._trigger[i])))
+      return false;
+  }
+  return true;
+}
+
+void TprConfig::disableChannel(unsigned i)
+{
+  if (i < TprBase::NCHANNELS)
+    memset(&_channel[i], 0, sizeof(Channel));
+}
+
+void TprConfig::disableTrigger(unsigned i)
+{
+  if (i < TprBase::NTRIGGERS)
+    memset(&_trigger[i], 0, sizeof(Trigger));
+}
+
+int TprConfig::load(const char* fname)
+{
+  FILE* f = fopen(fname,"r");
+  if (!f) {
+    perror("TprConfig: could not open");
+    return -1;
+  }
+
+  memset(_channel, 0, sizeof(_channel));
+  memset(_trigger, 0, sizeof(_trigger));
+
+  int  result = 0;
+  int  nline  = 0;
+  char line[256];
+  while(fgets(line, sizeof(line), f)) {
+    nline++;
+    if (parse(line) < 0) {
+      fprintf(stderr,"TprConfig: %s line %d: bad entry: %s", fname, nline, line);
+      result = -nline;
+      break;
+    }
+  }
+  fclose(f);
+  return result;
+}
+
+int TprConfig::parse(const char* l)
+{
+  char  buff[256];
+  char* tok[12];
+  unsigned ntok = 0;
+
+  strncpy(buff, l, sizeof(buff)-1);
+  buff[sizeof(buff)-1] = 0;
+  if (char* c = strchr(buff,'#'))
+    *c = 0;
+
+  char* save = 0;
+  for(char* t = strtok_r(buff," \t\r\n",&save); t && ntok<12; t = strtok_r(0," \t\r\n",&save))
+    tok[ntok++] = t;
+
+  if (ntok == 0)
+    return 0;
+  if (ntok < 3)
+    return -1;
+
+  char* endPtr;
+  unsigned i = strtoul(tok[1],&endPtr,0);
+  if (*endPtr)
+    return -1;
+
+  if (strcmp(tok[0],"channel")==0) {
+    if (i >= TprBase::NCHANNELS)
+      return -1;
+    uint32_t evtSel;
+    unsigned n;
+    if      (strcmp(tok[2],"fixed")==0 && ntok>=4) {
+      evtSel = fixedRate(strtoul(tok[3],0,0)); n = 4; }
+    else if (strcmp(tok[2],"ac")==0 && ntok>=5) {
+      evtSel = acRate(strtoul(tok[3],0,0), strtoul(tok[4],0,0)); n = 5; }
+    else if (strcmp(tok[2],"seq")==0 && ntok>=5) {
+      evtSel = sequence(strtoul(tok[3],0,0), strtoul(tok[4],0,0)); n = 5; }
+    else if (strcmp(tok[2],"beam")==0) {
+      bool d = ntok>=4 && strcmp(tok[3],"bsa")!=0;
+      evtSel = beam(d ? strtoul(tok[3],0,0) : 0); n = d ? 4 : 3; }
+    else if (strcmp(tok[2],"evtsel")==0 && ntok>=4) {
+      evtSel = strtoul(tok[3],0,0); n = 4; }
+    else
+      return -1;
+
+    if (n == ntok)
+      setChannel(i, evtSel);
+    else if (n+4 == ntok && strcmp(tok[n],"bsa")==0)
+      setChannel(i, evtSel,
+                 strtoul(tok[n+1],0,0), strtoul(tok[n+2],0,0), strtoul(tok[n+3],0,0));
+    else
+      return -1;
+  }
+  else if (strcmp(tok[0],"trigger")==0) {
+    if (i >= TprBase::NTRIGGERS || ntok < 5 || ntok > 6)
+      return -1;
+    bool polarity = false;
+    if (ntok == 6) {
+      if      (strcmp(tok[5],"pos")==0) polarity = true;
+      else if (strcmp(tok[5],"neg")!=0) return -1;
+    }
+    setTrigger(i, strtoul(tok[2],0,0), strtod(tok[3],0), strtod(tok[4],0), polarity);
+  }
+  else
+    return -1;
+
+  return 0;
+}
+
+void TprConfig::save(FILE* f) const
+{
+  for(unsigned i=0; i<TprBase::NCHANNELS; i++) {
+    const Channel& c = _channel[i];
+    if (!(c.control&1))
+      continue;
+    fprintf(f,"channel %u evtsel 0x%08x", i, c.evtSel);
+    if (c.control&2)
+      fprintf(f," bsa %u %u %u", c.bsaDelay>>20, c.bsaDelay&0xfffff, c.bsaWidth);
+    fprintf(f,"\n");
+  }
+  for(unsigned i=0; i<TprBase::NTRIGGERS; i++) {
+    const Trigger& t = _trigger[i];
+    if (!t.enabled())
+      continue;
+    fprintf(f,"trigger %u %u %.3f %.3f %s\n", i, t.control&0xffff,
+            (double(t.delay) + double(t.delayTap)/63.)*1.e9/CLK_FREQ,
+            double(t.width)*1.e9/CLK_FREQ,
+            (t.control&TRIG_POLARITY) ? "pos":"neg");
+  }
+}
+
+//  Reading back forces earlier posted writes to complete
+static void _flush(const TprBase& base)
+{
+  volatile uint32_t v = base.trigger[0].control;
+  (void)v;
+}
+
+unsigned TprConfig::apply(TprBase& base) const
+{
+  TprConfig cur(base);
+
+  bool     chch[TprBase::NCHANNELS];
+  bool     chtr[TprBase::NTRIGGERS];
+  Trigger  trig[TprBase::NTRIGGERS];
+  unsigned nchanged = 0;
+
+  for(unsigned i=0; i<TprBase::NCHANNELS; i++)
+    if ((chch[i] = !(_channel[i]==cur._channel[i])))
+      nchanged++;
+
+  //  A trigger fed by a changing channel is cycled as well.  A disabled
+  //  trigger keeps its idle level (polarity), and one already disabled
+  //  is left alone.
+  for(unsigned i=0; i<TprBase::NTRIGGERS; i++) {
+    trig[i] = _trigger[i];
+    if (!trig[i].enabled())
+      trig[i].control = cur._trigger[i].control & TRIG_POLARITY;
+    unsigned src = trig[i].control&0xffff;
+    if (!trig[i].enabled() && !cur._trigger[i].enabled())
+      chtr[i] = false;
+    else
+      chtr[i] = !(trig[i]==cur._trigger[i]) ||
+        (trig[i].enabled() && src < TprBase::NCHANNELS && chch[src]);
+    if (chtr[i])
+      nchanged++;
+  }
+
+  if (!nchanged)
+    return 0;
+
+  //  Disable; triggers hold their current idle level
+  for(unsigned i=0; i<TprBase::NTRIGGERS; i++)
+    if (chtr[i])
+      base.trigger[i].control = cur._trigger[i].control & TRIG_POLARITY;
+  for(unsigned i=0; i<TprBase::NCHANNELS; i++)
+    if (chch[i])
+      base.channel[i].control = 0;
+  _flush(base);
+
+  //  Timing fields
+  for(unsigned i=0; i<TprBase::NCHANNELS; i++)
+    if (chch[i]) {
+      base.channel[i].evtSel   = _channel[i].evtSel;
+      base.channel[i].bsaDelay = _channel[i].bsaDelay;
+      base.channel[i].bsaWidth = _channel[i].bsaWidth;
+    }
+  for(unsigned i=0; i<TprBase::NTRIGGERS; i++)
+    if (chtr[i]) {
+      base.trigger[i].delay    = trig[i].delay;
+      base.trigger[i].width    = trig[i].width;
+      base.trigger[i].delayTap = trig[i].delayTap;
+    }
+  _flush(base);
+
+  //  Enable
+  for(unsigned i=0; i<TprBase::NCHANNELS; i++)
+    if (chch[i])
+      base.channel[i].control = _channel[i].control;
+  for(unsigned i=0; i<TprBase::NTRIGGERS; i++)
+    if (chtr[i])
+      base.trigger[i].control = trig[i].control;
+  _flush(base);
+
+  return nchanged;
+}
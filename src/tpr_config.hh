@@ -0,0 +1,98 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef TPR_CONFIG_HH
+#define TPR_CONFIG_HH
+
+//
+//  Table of TPR channel and trigger settings in register units, applied
+//  in one pass: outputs whose settings changed are disabled, the timing
+//  fields of all changed outputs are written, and then they are enabled
+//  together.  Unchanged outputs are not touched.
+//
+//  File format (one entry per line, '#' starts a comment):
+//
+//    channel <i> fixed <rate>            [bsa <presample> <delay> <width>]
+//    channel <i> ac    <rate> <tsmask>   [bsa ...]
+//    channel <i> seq   <seq>  <bit>      [bsa ...]
+//    channel <i> beam  [<destn>]         [bsa ...]
+//    channel <i> evtsel <word>           [bsa ...]
+//    trigger <i> <channel> <delay,ns> <width,ns> [pos|neg]
+//
+//  Channels and triggers not listed are disabled.
+//
+#include <stdint.h>
+#include <stdio.h>
+
+#include "tpr.hh"
+
+namespace Tpr {
+
+  class TprConfig {
+  public:
+    class Channel {
+    public:
+      bool operator==(const Channel& o) const
+      { return control==o.control && evtSel==o.evtSel &&
+          bsaDelay==o.bsaDelay && bsaWidth==o.bsaWidth; }
+    public:
+      uint32_t control;  // 0 = disabled
+      uint32_t evtSel;
+      uint32_t bsaDelay;
+      uint32_t bsaWidth;
+    };
+    class Trigger {
+    public:
+      bool     enabled () const { return control&(1U<<31); }
+      bool operator==(const Trigger& o) const
+      { return control==o.control && delay==o.delay &&
+          width==o.width && delayTap==o.delayTap; }
+    public:
+      uint32_t control;  // source, polarity, enable
+      uint32_t delay;    // 186M clocks
+      uint32_t width;
+      uint32_t delayTap; // 1/63 of a clock
+    };
+  public:
+    //  All outputs disabled
+    TprConfig();
+    //  The current hardware settings
+    TprConfig(const TprBase&);
+  public:
+    //  Returns 0, or the (negative) line number of the first bad entry
+    int      load       (const char* fname);
+    int      parse      (const char* line);
+    void     save       (FILE*) const;
+  public:
+    void     setChannel (unsigned i, uint32_t evtSel,
+                         unsigned bsaPresample=0, unsigned bsaDelay=0, unsigned bsaWidth=0);
+    //  delay, width in ns; rounded to the nearest tap and clock here
+    void     setTrigger (unsigned i, unsigned source,
+                         double delay_ns, double width_ns, bool polarity);
+    void     disableChannel(unsigned i);
+    void     disableTrigger(unsigned i);
+    const Channel& channel(unsigned i) const { return _channel[i]; }
+    const Trigger& trigger(unsigned i) const { return _trigger[i]; }
+    //  Same outputs enabled, with the same settings (as save() writes)
+    bool     operator== (const TprConfig&) const;
+  public:
+    //  Program the hardware; returns the number of outputs changed
+    unsigned apply      (TprBase&) const;
+  public:
+    static uint32_t fixedRate(unsigned rate);
+    static uint32_t acRate   (unsigned rate, unsigned tsmask);
+    static uint32_t sequence (unsigned seq, unsigned bit);
+    static uint32_t beam     (unsigned destn=0);
+  private:
+    Channel _channel[TprBase::NCHANNELS];
+    Trigger _trigger[TprBase::NTRIGGERS];
+  };
+};
+
+#endif
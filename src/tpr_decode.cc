@@ -0,0 +1,220 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+//
+//  Decode benchmark for TPR messages.  Messages are TprEntry records, read
+//  from a file recorded earlier with -r, or generated.
+//
+#include <stdio.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <vector>
+
+#include "tpr_segments.hh"
+#include "tpr_queue.hh"
+#include "tpr_placement.hh"
+
+using namespace Tpr;
+
+static void usage(const char* p) {
+  printf("Usage: %s [options]\n",p);
+  printf("Options: -f <filename>         : Decode messages recorded in file\n");
+  printf("         -r <tprid>,<channel>  : Record messages from the TPR to file (-f)\n");
+  printf("         -n <messages>         : Number of messages to record or generate\n");
+  printf("         -i <iterations>       : Passes over the messages\n");
+  printf("         -P                    : Record with huge pages, pinned to the TPR's NUMA node\n");
+}
+
+static double elapsed(const timespec& t0, const timespec& t1)
+{
+  return double(t1.tv_sec-t0.tv_sec)+1.e-9*double(t1.tv_nsec-t0.tv_nsec);
+}
+
+//  Event and BSA segments in the mix the TPR produces, with the source
+//  and drop flags set on some
+static void generate(std::vector<TprEntry>& msgs, unsigned n)
+{
+  msgs.resize(n);
+  for(unsigned i=0; i<n; i++) {
+    char* p = reinterpret_cast<char*>(const_cast<uint32_t*>(msgs[i].word));
+    memset(p, 0, sizeof(TprEntry));
+    SegmentType type = (i%16)==0 ? _BsaControl : (i%16)==1 ? _BsaChannel : _Event;
+    unsigned    sz   = segmentSize(type);
+    uint32_t    hdr  = uint32_t(type)<<16;
+    if (i&1)      hdr |= 1<<22;  // source
+    if ((i%8)==3) hdr |= 1<<23;  // drop
+    memcpy(p, &hdr, sizeof(hdr));
+    uint64_t pid = i;
+    memcpy(p+8, &pid, sizeof(pid));  // pulseId follows the header in each type
+    if (sz + sizeof(SegmentHeader) <= sizeof(TprEntry)) {
+      hdr = uint32_t(_End)<<16;
+      memcpy(p+sz, &hdr, sizeof(hdr));
+    }
+  }
+}
+
+static int record(const char* dev, const char* fname, unsigned n, bool place)
+{
+  unsigned ch = 0;
+  if (strlen(dev)<3 || sscanf(dev+2,"%u",&ch)!=1) {
+    printf("Bad device %s\n",dev);
+    return -1;
+  }
+
+  TprQueueReader reader(dev[0], ch,
+                        place ? (TprPlacement::HugePages|TprPlacement::Populate) : 0);
+  if (!reader.isOpen())
+    return -1;
+
+  if (place) {
+    char name[32];
+    sprintf(name,"/dev/tpr%c%x",dev[0],ch);
+    TprPlacement p(name);
+    p.pinThread();
+    p.report(stdout);
+    printf("%s: queues on node %d, %u kB pages\n", name,
+           TprPlacement::nodeOf(&reader.queues()),
+           TprPlacement::pageSize(&reader.queues())/1024);
+  }
+
+  FILE* f = fopen(fname,"w");
+  if (!f) {
+    perror("Failed to open output");
+    return -1;
+  }
+
+  unsigned nrec = 0;
+  while(nrec < n) {
+    if (reader.wait() < 0)
+      break;
+    TprQueueReader::Batch b = reader.poll(n-nrec);
+    for(TprQueueReader::Batch::iterator it=b.begin(); it!=b.end(); ++it) {
+      TprEntry e = *it;
+      if (reader.intact(it) && fwrite(const_cast<uint32_t*>(e.word), sizeof(e.word), 1, f)==1)
+        nrec++;
+    }
+    reader.release(b);
+  }
+  fclose(f);
+
+  printf("Recorded %u messages (%llu overruns)\n", nrec, (unsigned long long)reader.overruns());
+  return 0;
+}
+
+int main(int argc, char** argv) {
+
+  const char* fname = 0;
+  const char* dev   = 0;
+  unsigned nmsgs = 4096;
+  unsigned niter = 1000;
+  bool     place = false;
+
+  opterr = 0;
+
+  int c;
+  while( (c=getopt(argc,argv,"f:r:n:i:Ph"))!=-1 ) {
+    switch(c) {
+    case 'f':
+      fname = optarg;
+      break;
+    case 'r':
+      dev = optarg;
+      break;
+    case 'n':
+      nmsgs = strtoul(optarg,NULL,0);
+      break;
+    case 'i':
+      niter = strtoul(optarg,NULL,0);
+      break;
+    case 'P':
+      place = true;
+      break;
+    default:
+      usage(argv[0]); return 1;
+    }
+  }
+
+  if (dev) {
+    if (!fname) {
+      usage(argv[0]); return 1;
+    }
+    return record(dev, fname, nmsgs, place);
+  }
+
+  std::vector<TprEntry> msgs;
+  if (fname) {
+    FILE* f = fopen(fname,"r");
+    if (!f) {
+      perror("Failed to open input");
+      return -1;
+    }
+    TprEntry e;
+    while(fread(const_cast<uint32_t*>(e.word), sizeof(e.word), 1, f)==1)
+      msgs.push_back(e);
+    fclose(f);
+    printf("Read %zu messages from %s\n", msgs.size(), fname);
+  }
+  else
+    generate(msgs, nmsgs);
+
+  if (msgs.empty())
+    return 0;
+
+  //  Sum fields from each view so the decode isn't optimized away
+  uint64_t nseg[3] = {0,0,0};
+  uint64_t sum = 0;
+  unsigned incomplete = 0;
+
+  timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+
+  for(unsigned k=0; k<niter; k++) {
+    for(unsigned i=0; i<msgs.size(); i++) {
+      for(const Segment& s : SegmentRange(msgs[i])) {
+        if (const Event* e = s.event()) {
+          nseg[_Event]++;
+          sum += e->pulseId + e->fixedRates;
+        }
+        else if (const BsaControl* b = s.bsaControl()) {
+          nseg[_BsaControl]++;
+          sum += b->pulseId ^ b->active;
+        }
+        else if (const BsaChannel* b = s.bsaChannel()) {
+          nseg[_BsaChannel]++;
+          sum += b->pulseId ^ b->newActive;
+        }
+      }
+    }
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  for(unsigned i=0; i<msgs.size(); i++)
+    if (!SegmentRange(msgs[i]).complete())
+      incomplete++;
+
+  double   dt    = elapsed(t0,t1);
+  uint64_t total = nseg[0]+nseg[1]+nseg[2];
+  printf("Messages %zu x %u : incomplete %u\n", msgs.size(), niter, incomplete);
+  printf("Segments %llu : Event %llu  BsaControl %llu  BsaChannel %llu  [%llx]\n",
+         (unsigned long long)total,
+         (unsigned long long)nseg[_Event],
+         (unsigned long long)nseg[_BsaControl],
+         (unsigned long long)nseg[_BsaChannel],
+         (unsigned long long)sum);
+  printf("Elapsed %f s : %.1f Msegments/s  %.1f ns/message\n",
+         dt, dt>0 ? 1.e-6*double(total)/dt : 0.,
+         1.e9*dt/(double(msgs.size())*double(niter)));
+
+  return 0;
+}
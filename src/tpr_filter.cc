@@ -0,0 +1,192 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "tpr_filter.hh"
+#include "event_selection.hh"
+
+#include <string.h>
+
+//
+//  Event bits:
+//    [0,22)     fixedRates(10), acRates(6), acTimeSlots(6) as in Event
+//    [32,320)   control[w] bit b at 32+16*w+b
+//    [320,336)  destination one-hot, if beam requested
+//    336        no beam requested
+//
+static const unsigned NRATEBITS = 22;
+static const unsigned CTRL_BIT  = 32;
+static const unsigned NCTRL     = 18;
+static const unsigned DEST_BIT  = CTRL_BIT+16*NCTRL;
+static const unsigned NOBEAM    = DEST_BIT+16;
+static const unsigned NPLANES   = NOBEAM+1;
+
+using namespace Tpr;
+
+//  The rate and timeslot bit fields follow the timestamp
+static inline uint32_t _rateBits(const Event& e)
+{
+  uint32_t v;
+  memcpy(&v, reinterpret_cast<const char*>(&e.timeStamp)+sizeof(e.timeStamp), sizeof(v));
+  return v & ((1<<NRATEBITS)-1);
+}
+
+EventFilter::EventFilter() {}
+
+EventFilter::~EventFilter() {}
+
+unsigned EventFilter::add(const TPGen::EventSelection& s)
+{
+  return add(s.word());
+}
+
+void EventFilter::_term(const std::vector<unsigned>& bits, bool always)
+{
+  Term t;
+  t.first = _bits.size();
+  t.count = always ? uint16_t(ALWAYS) : uint16_t(bits.size());
+  for(unsigned i=0; i<bits.size(); i++)
+    _bits.push_back(bits[i]);
+  _terms.push_back(t);
+}
+
+unsigned EventFilter::add(uint32_t v)
+{
+  std::vector<unsigned> rate, ts, dst;
+  bool tsAny = true;
+
+  switch((v>>11)&3) {
+  case 0:   // Fixed rate
+    if ((v&0xf) < 10)
+      rate.push_back(v&0xf);
+    break;
+  case 1:   // AC rate and timeslot mask
+    if ((v&7) < 6)
+      rate.push_back(10+(v&7));
+    tsAny = false;
+    for(unsigned i=0; i<6; i++)
+      if ((v>>(3+i))&1)
+        ts.push_back(16+i);
+    break;
+  case 2: { // Control sequence bit
+    unsigned seq = (v>>5)&0x3f, bit = v&0x1f;
+    if (seq < NCTRL && bit < 16)
+      rate.push_back(CTRL_BIT+16*seq+bit);
+    break; }
+  default:
+    break;
+  }
+
+  bool dstAny = false;
+  switch((v>>29)&3) {
+  case 0:   // One of
+    for(unsigned i=0; i<16; i++)
+      if ((v>>(13+i))&1)
+        dst.push_back(DEST_BIT+i);
+    break;
+  case 1:   // No beam
+    dst.push_back(NOBEAM);
+    break;
+  case 2:   // Don't care
+    dstAny = true;
+    break;
+  default:
+    break;
+  }
+
+  _term(rate, false);
+  _term(ts  , tsAny);
+  _term(dst , dstAny);
+  return size()-1;
+}
+
+void EventFilter::clear()
+{
+  _terms.clear();
+  _bits .clear();
+}
+
+void EventFilter::match(const Event* const* events, unsigned n, uint64_t* result) const
+{
+  //  Transpose the block: planes[bit] has bit e set if event e has it
+  uint64_t planes[NPLANES];
+  memset(planes, 0, sizeof(planes));
+
+  for(unsigned e=0; e<n && e<BLOCK; e++) {
+    const Event& ev = *events[e];
+    uint64_t     eb = 1ULL<<e;
+    for(uint32_t v=_rateBits(ev); v; v&=v-1)
+      planes[__builtin_ctz(v)] |= eb;
+    for(unsigned w=0; w<NCTRL; w++)
+      for(uint32_t v=ev.control[w]; v; v&=v-1)
+        planes[CTRL_BIT+16*w+__builtin_ctz(v)] |= eb;
+    if (ev.beamReq)
+      planes[DEST_BIT+ev.destn] |= eb;
+    else
+      planes[NOBEAM] |= eb;
+  }
+
+  uint64_t all = n < BLOCK ? (1ULL<<n)-1 : ~0ULL;
+  const Term*     t = _terms.data();
+  const uint16_t* b = _bits .data();
+  for(unsigned s=0; s<size(); s++, t+=3) {
+    uint64_t r = all;
+    for(unsigned k=0; k<3 && r; k++) {
+      if (t[k].count == ALWAYS)
+        continue;
+      uint64_t m = 0;
+      for(unsigned i=0; i<t[k].count; i++)
+        m |= planes[b[t[k].first+i]];
+      r &= m;
+    }
+    result[s] = r;
+  }
+}
+
+void EventFilter::filter(const Event* const* events, unsigned n,
+                         std::vector< std::vector<unsigned> >& lists) const
+{
+  lists.resize(size());
+  for(unsigned s=0; s<size(); s++)
+    lists[s].clear();
+
+  std::vector<uint64_t> result(size());
+  for(unsigned e0=0; e0<n; e0+=BLOCK) {
+    match(events+e0, n-e0, result.data());
+    for(unsigned s=0; s<size(); s++)
+      for(uint64_t r=result[s]; r; r&=r-1)
+        lists[s].push_back(e0+__builtin_ctzll(r));
+  }
+}
+
+//  Scalar test of one event bit
+static bool _hasBit(const Event& e, unsigned b)
+{
+  if (b < CTRL_BIT)
+    return (_rateBits(e)>>b)&1;
+  if (b < DEST_BIT)
+    return (e.control[(b-CTRL_BIT)/16]>>((b-CTRL_BIT)%16))&1;
+  if (b < NOBEAM)
+    return e.beamReq && e.destn==b-DEST_BIT;
+  return !e.beamReq;
+}
+
+bool EventFilter::select(unsigned s, const Event& e) const
+{
+  const Term* t = &_terms[3*s];
+  for(unsigned k=0; k<3; k++) {
+    if (t[k].count == ALWAYS)
+      continue;
+    bool any = false;
+    for(unsigned i=0; i<t[k].count && !any; i++)
+      any = _hasBit(e, _bits[t[k].first+i]);
+    if (!any)
+      return false;
+  }
+  return true;
+}
@@ -0,0 +1,73 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef TPR_FILTER_HH
+#define TPR_FILTER_HH
+
+//
+//  Software equivalent of the TPR channel event selection (evtSel), for
+//  consumers that take every event and split the stream into virtual
+//  channels.
+//
+//  Selections are EventSelection words (event_selection.cc).  Each is
+//  compiled to three terms: rate/sequence, timeslot, destination.  A term
+//  matches if any of its event bits is set.
+//
+//  Events are evaluated in blocks of 64: the block is transposed into one
+//  64-bit word per event bit (bit e set if event e has it), so a term is
+//  the OR of a few such words and a selection the AND of three, deciding
+//  all 64 events at once.
+//
+#include <stdint.h>
+
+#include <vector>
+
+#include "tprdata.hh"
+
+namespace TPGen {
+  class EventSelection;
+};
+
+namespace Tpr {
+
+  class EventFilter {
+  public:
+    enum { BLOCK = 64 };
+  public:
+    EventFilter();
+    ~EventFilter();
+  public:
+    //  Returns the selection's index
+    unsigned add   (const TPGen::EventSelection&);
+    unsigned add   (uint32_t word);
+    void     clear ();
+    unsigned size  () const { return _terms.size()/3; }
+  public:
+    //  Bit e of result[s] is set if selection s takes event e; n <= BLOCK
+    void     match (const Event* const* events, unsigned n, uint64_t* result) const;
+    //  Indices into events[] taken by each selection
+    void     filter(const Event* const* events, unsigned n,
+                    std::vector< std::vector<unsigned> >& lists) const;
+    //  One selection, one event (reference)
+    bool     select(unsigned s, const Event&) const;
+  private:
+    class Term {
+    public:
+      uint16_t first;   // into _bits
+      uint16_t count;   // ALWAYS: matches every event
+    };
+    enum { ALWAYS = 0xffff };
+    void     _term  (const std::vector<unsigned>& bits, bool always);
+  private:
+    std::vector<Term>     _terms;  // three per selection
+    std::vector<uint16_t> _bits;   // event bit numbers
+  };
+};
+
+#endif
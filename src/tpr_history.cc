@@ -0,0 +1,195 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "tpr_history.hh"
+#include "tpr_segments.hh"
+#include "tpr_placement.hh"
+
+#include <stdio.h>
+#include <string.h>
+
+static const uint32_t BUSY      = 0xffffffff;
+static const unsigned NCONTROL  = 18;
+
+using namespace Tpr;
+
+template <typename T>
+static inline void _st(T* p, T v) { __atomic_store_n(p, v, __ATOMIC_RELAXED); }
+
+template <typename T>
+static inline T    _ld(const T* p) { return __atomic_load_n(p, __ATOMIC_RELAXED); }
+
+template <typename T>
+static T* _column(size_t n, bool hugePages)
+{
+  return static_cast<T*>(TprPlacement::allocLocal(n*sizeof(T), hugePages));
+}
+
+template <typename T>
+static void _free(T* p, size_t n, bool hugePages)
+{
+  TprPlacement::freeLocal(p, n*sizeof(T), hugePages);
+}
+
+EventHistory::EventHistory(unsigned log2Slots, unsigned columns, bool hugePages) :
+  _shift    (log2Slots),
+  _mask     ((1ULL<<log2Slots)-1),
+  _columns  (columns|Core),
+  _hugePages(hugePages),
+  _tag      (0),
+  _timeStamp(0),
+  _rates    (0),
+  _energy   (0),
+  _wavelen  (0),
+  _mpsClass (0),
+  _mpsLimit (0),
+  _control  (0),
+  _newest   (0)
+{
+  size_t n = slots();
+  _tag       = _column<uint32_t>(n, hugePages);
+  _timeStamp = _column<uint64_t>(n, hugePages);
+  _rates     = _column<uint64_t>(n, hugePages);
+  if (_columns & Energy) {
+    _energy  = _column<uint64_t>(n, hugePages);
+    _wavelen = _column<uint32_t>(n, hugePages);
+  }
+  if (_columns & Mps) {
+    _mpsClass = _column<uint64_t>(n, hugePages);
+    _mpsLimit = _column<uint16_t>(n, hugePages);
+  }
+  if (_columns & Control)
+    _control = _column<uint16_t>(n*NCONTROL, hugePages);
+
+  if (!_tag || !_timeStamp || !_rates ||
+      ((_columns & Energy ) && (!_energy || !_wavelen)) ||
+      ((_columns & Mps    ) && (!_mpsClass || !_mpsLimit)) ||
+      ((_columns & Control) && !_control)) {
+    fprintf(stderr,"EventHistory: failed to allocate %zu bytes\n",bytes());
+    _free(_tag, n, hugePages);
+    _tag = 0;
+  }
+}
+
+EventHistory::~EventHistory()
+{
+  size_t n = slots();
+  _free(_tag      , n, _hugePages);
+  _free(_timeStamp, n, _hugePages);
+  _free(_rates    , n, _hugePages);
+  _free(_energy   , n, _hugePages);
+  _free(_wavelen  , n, _hugePages);
+  _free(_mpsClass , n, _hugePages);
+  _free(_mpsLimit , n, _hugePages);
+  _free(_control  , n*NCONTROL, _hugePages);
+}
+
+size_t EventHistory::bytes() const
+{
+  size_t per = 20;
+  if (_columns & Energy ) per += 12;
+  if (_columns & Mps    ) per += 10;
+  if (_columns & Control) per += 2*NCONTROL;
+  return per*slots();
+}
+
+//  Tags are never 0 (empty) or BUSY
+static inline uint32_t _tagOf(uint64_t pulseId, unsigned shift)
+{
+  return uint32_t((pulseId>>shift) % (BUSY-1)) + 1;
+}
+
+void EventHistory::insert(const Event& e)
+{
+  uint64_t pid = e.pulseId;
+  uint64_t s   = pid & _mask;
+
+  _st(&_tag[s], BUSY);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  //  The two words of rate, timeslot and beam bit fields follow the timestamp
+  uint64_t rates;
+  memcpy(&rates, reinterpret_cast<const char*>(&e.timeStamp)+sizeof(e.timeStamp), sizeof(rates));
+
+  _st(&_timeStamp[s], e.timeStamp);
+  _st(&_rates    [s], rates);
+  if (_energy) {
+    uint64_t v; uint32_t w;
+    memcpy(&v, e.beamEnergy   , sizeof(v));
+    memcpy(&w, e.photonWavelen, sizeof(w));
+    _st(&_energy [s], v);
+    _st(&_wavelen[s], w);
+  }
+  if (_mpsClass) {
+    _st(&_mpsClass[s], e.mpsClass);
+    _st(&_mpsLimit[s], e.mpsLimit);
+  }
+  if (_control) {
+    uint16_t* c = &_control[s*NCONTROL];
+    for(unsigned i=0; i<NCONTROL; i++)
+      _st(&c[i], e.control[i]);
+  }
+
+  __atomic_store_n(&_tag[s], _tagOf(pid,_shift), __ATOMIC_RELEASE);
+  __atomic_store_n(&_newest, pid, __ATOMIC_RELEASE);
+}
+
+unsigned EventHistory::insert(const TprQueueReader& r, const TprQueueReader::Batch& b)
+{
+  unsigned n = 0;
+  for(TprQueueReader::Batch::iterator it=b.begin(); it!=b.end(); ++it) {
+    for(const Segment& seg : SegmentRange(*it)) {
+      const Event* e = seg.event();
+      if (!e)
+        continue;
+      //  Copy out of the queue first; only a copy the driver did not
+      //  overwrite meanwhile reaches the history
+      Event ev;
+      memcpy(&ev, e, sizeof(ev));
+      if (!r.intact(it))
+        continue;
+      insert(ev);
+      n++;
+    }
+  }
+  return n;
+}
+
+bool EventHistory::lookup(uint64_t pulseId, HistoryEntry& h) const
+{
+  uint64_t s   = pulseId & _mask;
+  uint32_t tag = _tagOf(pulseId,_shift);
+
+  if (__atomic_load_n(&_tag[s], __ATOMIC_ACQUIRE) != tag)
+    return false;
+
+  memset(&h, 0, sizeof(h));
+  h.pulseId   = pulseId;
+  h.timeStamp = _ld(&_timeStamp[s]);
+  h.rates     = _ld(&_rates    [s]);
+  if (_energy) {
+    uint64_t v = _ld(&_energy [s]);
+    uint32_t w = _ld(&_wavelen[s]);
+    memcpy(h.beamEnergy   , &v, sizeof(v));
+    memcpy(h.photonWavelen, &w, sizeof(w));
+  }
+  if (_mpsClass) {
+    h.mpsClass = _ld(&_mpsClass[s]);
+    h.mpsLimit = _ld(&_mpsLimit[s]);
+  }
+  if (_control) {
+    const uint16_t* c = &_control[s*NCONTROL];
+    for(unsigned i=0; i<NCONTROL; i++)
+      h.control[i] = _ld(&c[i]);
+  }
+
+  //  Rewritten meanwhile?
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return _ld(&_tag[s]) == tag;
+}
@@ -0,0 +1,103 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef TPR_HISTORY_HH
+#define TPR_HISTORY_HH
+
+//
+//  History of timing events indexed by pulse ID.
+//
+//  A ring of 2^n slots; pulse ID p lives in slot p mod 2^n, so lookup is
+//  one index calculation.  Fields are stored in columns and only the
+//  selected column groups are allocated:
+//
+//    Core     20 B  tag, timestamp, rates/timeslot/beam/destn/charge word
+//    Energy   12 B  beam energy[4], photon wavelength[2]
+//    Mps      10 B  MPS class, MPS limit
+//    Control  36 B  control words
+//
+//  e.g. 2^26 slots (72 s at 929 kHz) of Core take 1.3 GB.
+//
+//  One thread inserts; any number of threads look up concurrently.  Each
+//  slot's tag acts as a sequence lock: a lookup that overlaps a rewrite of
+//  its slot fails rather than returning a torn event.
+//
+#include <stdint.h>
+
+#include "tprdata.hh"
+#include "tpr_queue.hh"
+
+namespace Tpr {
+
+  class HistoryEntry {
+  public:
+    unsigned fixedRates() const { return (rates>> 0)&0x3ff; }
+    unsigned acRates   () const { return (rates>>10)&0x3f; }
+    unsigned acTimeSlot() const { return (rates>>16)&0x3f; }
+    bool     beamReq   () const { return (rates>>32)&1; }
+    unsigned destn     () const { return (rates>>36)&0xf; }
+    unsigned charge    () const { return (rates>>48)&0xffff; }
+  public:
+    uint64_t pulseId;
+    uint64_t timeStamp;
+    uint64_t rates;          // Event's two rate/beam words as stored
+    uint16_t beamEnergy[4];
+    uint16_t photonWavelen[2];
+    uint16_t mpsLimit;
+    uint64_t mpsClass;
+    uint16_t control[18];
+  };
+
+  class EventHistory {
+  public:
+    enum Columns { Core=1, Energy=2, Mps=4, Control=8, All=15 };
+  public:
+    EventHistory(unsigned log2Slots, unsigned columns=Core, bool hugePages=false);
+    ~EventHistory();
+  public:
+    bool     isOpen  () const { return _tag!=0; }
+    unsigned slots   () const { return _mask+1; }
+    unsigned columns () const { return _columns; }
+    size_t   bytes   () const;
+  public:
+    //  Writer
+    void     insert  (const Event&);
+    //  Copy the batch's Event segments; entries the driver reused while
+    //  being copied are dropped.  Returns the number inserted.
+    unsigned insert  (const TprQueueReader&, const TprQueueReader::Batch&);
+  public:
+    //  Readers; false if the pulse is not (or no longer) held.  Fields of
+    //  columns not kept are left zero.
+    bool     lookup  (uint64_t pulseId, HistoryEntry&) const;
+    uint64_t newest  () const { return __atomic_load_n(&_newest, __ATOMIC_ACQUIRE); }
+  private:
+    EventHistory(const EventHistory&);
+    EventHistory& operator=(const EventHistory&);
+  private:
+    unsigned  _shift;
+    uint64_t  _mask;
+    unsigned  _columns;
+    bool      _hugePages;
+    //  Core
+    uint32_t* _tag;        // (pulseId>>_shift)+1; 0 = empty, ~0 = being written
+    uint64_t* _timeStamp;
+    uint64_t* _rates;
+    //  Energy
+    uint64_t* _energy;
+    uint32_t* _wavelen;
+    //  Mps
+    uint64_t* _mpsClass;
+    uint16_t* _mpsLimit;
+    //  Control
+    uint16_t* _control;    // [slot][18]
+    uint64_t  _newest;
+  };
+};
+
+#endif
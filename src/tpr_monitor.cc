@@ -0,0 +1,87 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+//
+//  Monitor of the TPR consumers' telemetry page
+//
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tpr_telemetry.hh"
+
+using namespace Tpr;
+
+static void usage(const char* p) {
+  printf("Usage: %s [options]\n",p);
+  printf("Options: -d <a..z>   : /dev/tpr<arg>\n");
+  printf("         -i <seconds> : update interval\n");
+  printf("         -1           : print once\n");
+}
+
+int main(int argc, char** argv) {
+
+  char     tprid    = 'a';
+  unsigned interval = 1;
+  bool     once     = false;
+
+  int c;
+  while( (c=getopt(argc,argv,"d:i:1h"))!=-1 ) {
+    switch(c) {
+    case 'd':
+      tprid = optarg[0];
+      break;
+    case 'i':
+      interval = strtoul(optarg,NULL,0);
+      break;
+    case '1':
+      once = true;
+      break;
+    default:
+      usage(argv[0]); return 1;
+    }
+  }
+
+  TprTelemetry telemetry(tprid, false);
+  if (!telemetry.isOpen())
+    return -1;
+
+  const TprTelemetryPage& page = telemetry.page();
+
+  while(1) {
+    printf("%4.4s %7.7s %12.12s %10.10s %8.8s %8.8s %10.10s %9.9s %9.9s %9.9s %9.9s %4.4s\n",
+           "Chan","pid","events","rate[Hz]","lagAvg","lagMax","overruns",
+           "avg[us]","p50[us]","p99[us]","max[us]","full");
+    for(unsigned i=0; i<MOD_SHARED; i++) {
+      TprChannelStats s;
+      memcpy(&s, &page.channel[i], sizeof(s));
+      if (!s.pid)
+        continue;
+      printf("%4u %7d %12llu %10.1f %8.1f %8llu %10llu %9.1f %9.0f %9.0f %9.1f %4u\n",
+             i, s.pid,
+             (unsigned long long)s.events,
+             s.rate,
+             s.batches ? double(s.lagSum)/double(s.batches) : 0.,
+             (unsigned long long)s.lagMax,
+             (unsigned long long)s.overruns,
+             s.latSamples ? 1.e-3*double(s.latNs)/double(s.latSamples) : 0.,
+             s.percentileUs(0.50),
+             s.percentileUs(0.99),
+             1.e-3*double(s.latMaxNs),
+             s.fifoFull);
+    }
+    if (once)
+      break;
+    printf("\n");
+    sleep(interval);
+  }
+
+  return 0;
+}
@@ -0,0 +1,223 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "tpr_placement.hh"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+
+static const size_t HUGE_PAGE = 2*1024*1024;
+
+using namespace Tpr;
+
+static bool _readLine(const char* fname, char* buff, unsigned len)
+{
+  FILE* f = fopen(fname,"r");
+  if (!f)
+    return false;
+  bool result = fgets(buff, len, f)!=0;
+  fclose(f);
+  return result;
+}
+
+//  Parse a sysfs cpu list, e.g. "0-7,16-23"
+static void _parseCpus(const char* s, std::vector<unsigned>& cpus)
+{
+  char* endPtr;
+  while(*s) {
+    unsigned lo = strtoul(s,&endPtr,10);
+    if (endPtr==s)
+      break;
+    unsigned hi = lo;
+    if (*endPtr=='-')
+      hi = strtoul(endPtr+1,&endPtr,10);
+    for(unsigned i=lo; i<=hi; i++)
+      cpus.push_back(i);
+    s = endPtr;
+    if (*s==',')
+      s++;
+  }
+}
+
+static std::string _cpuString(const std::vector<unsigned>& cpus)
+{
+  std::string s;
+  char buff[32];
+  for(unsigned i=0; i<cpus.size(); ) {
+    unsigned j=i;
+    while(j+1<cpus.size() && cpus[j+1]==cpus[j]+1)
+      j++;
+    if (j>i)
+      sprintf(buff,"%s%u-%u",s.empty()?"":",",cpus[i],cpus[j]);
+    else
+      sprintf(buff,"%s%u",s.empty()?"":",",cpus[i]);
+    s += buff;
+    i = j+1;
+  }
+  return s;
+}
+
+TprPlacement::TprPlacement(const char* dev) :
+  _dev (dev),
+  _node(-1)
+{
+  struct stat st;
+  if (stat(dev,&st) < 0 || !S_ISCHR(st.st_mode))
+    return;
+
+  char fname[128], buff[256];
+  sprintf(fname,"/sys/dev/char/%u:%u/device/numa_node",
+          major(st.st_rdev), minor(st.st_rdev));
+  if (!_readLine(fname,buff,sizeof(buff)))
+    return;
+
+  _node = strtol(buff,0,0);
+  if (_node < 0)
+    return;
+
+  sprintf(fname,"/sys/devices/system/node/node%d/cpulist",_node);
+  if (_readLine(fname,buff,sizeof(buff)))
+    _parseCpus(buff,_cpus);
+}
+
+int TprPlacement::pinThread(pthread_t t) const
+{
+  if (_cpus.empty())
+    return -1;
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for(unsigned i=0; i<_cpus.size(); i++)
+    CPU_SET(_cpus[i], &set);
+
+  int r = pthread_setaffinity_np(t, sizeof(set), &set);
+  if (r) {
+    errno = r;
+    perror("TprPlacement: pthread_setaffinity_np");
+    return -1;
+  }
+  return 0;
+}
+
+void TprPlacement::report(FILE* f) const
+{
+  if (_node < 0)
+    fprintf(f,"%s: NUMA node unknown\n",_dev.c_str());
+  else
+    fprintf(f,"%s: NUMA node %d, cpus %s\n",_dev.c_str(),_node,_cpuString(_cpus).c_str());
+
+  cpu_set_t set;
+  if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set)==0) {
+    std::vector<unsigned> cpus;
+    for(unsigned i=0; i<CPU_SETSIZE; i++)
+      if (CPU_ISSET(i,&set))
+        cpus.push_back(i);
+    fprintf(f,"%s: this thread on cpus %s, now on cpu %d\n",
+            _dev.c_str(),_cpuString(cpus).c_str(),sched_getcpu());
+  }
+}
+
+void* TprPlacement::map(int fd, size_t len, int prot, unsigned flags)
+{
+  void* hint = 0;
+  if (flags & HugePages) {
+    //  Find a free huge page aligned range for the mapping
+    void* r = mmap(0, len+HUGE_PAGE, PROT_NONE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (r != MAP_FAILED) {
+      hint = reinterpret_cast<void*>((reinterpret_cast<uintptr_t>(r)+HUGE_PAGE-1) & ~(HUGE_PAGE-1));
+      munmap(r, len+HUGE_PAGE);
+    }
+  }
+
+  int mflags = MAP_SHARED;
+  if (flags & Populate)
+    mflags |= MAP_POPULATE;
+
+  void* p = mmap(hint, len, prot, mflags, fd, 0);
+  if (p == MAP_FAILED) {
+    perror("TprPlacement: mmap");
+    return 0;
+  }
+
+  //  Ignored where the driver does not support it
+  if (flags & HugePages)
+    madvise(p, len, MADV_HUGEPAGE);
+
+  return p;
+}
+
+void* TprPlacement::allocLocal(size_t len, bool hugePages)
+{
+  if (hugePages)
+    len = (len+HUGE_PAGE-1) & ~(HUGE_PAGE-1);
+
+  void* p = MAP_FAILED;
+  if (hugePages)
+    p = mmap(0, len, PROT_READ|PROT_WRITE,
+             MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB|MAP_POPULATE, -1, 0);
+  if (p == MAP_FAILED) {
+    //  No reserved huge pages; transparent huge pages if enabled
+    p = mmap(0, len, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+      perror("TprPlacement: allocLocal");
+      return 0;
+    }
+    if (hugePages)
+      madvise(p, len, MADV_HUGEPAGE);
+    //  First touch from this thread places the pages on its node
+    memset(p, 0, len);
+  }
+  return p;
+}
+
+void TprPlacement::freeLocal(void* p, size_t len, bool hugePages)
+{
+  if (!p)
+    return;
+  if (hugePages)
+    len = (len+HUGE_PAGE-1) & ~(HUGE_PAGE-1);
+  munmap(p, len);
+}
+
+unsigned TprPlacement::pageSize(const void* addr)
+{
+  FILE* f = fopen("/proc/self/smaps","r");
+  if (!f)
+    return 0;
+
+  uintptr_t a = reinterpret_cast<uintptr_t>(addr);
+  bool      found = false;
+  unsigned  kb = 0;
+  char      line[256];
+  while(fgets(line, sizeof(line), f)) {
+    unsigned long lo, hi;
+    if (sscanf(line,"%lx-%lx ",&lo,&hi)==2 && strchr(line,'-') < strchr(line,' '))
+      found = (a >= lo && a < hi);
+    else if (found && sscanf(line,"KernelPageSize: %u kB",&kb)==1)
+      break;
+  }
+  fclose(f);
+  return kb*1024;
+}
+
+int TprPlacement::nodeOf(const void* addr)
+{
+  void* page   = const_cast<void*>(addr);
+  int   status = -1;
+  if (syscall(SYS_move_pages, 0, 1UL, &page, (const int*)0, &status, 0) < 0)
+    return -1;
+  return status;
+}
@@ -0,0 +1,64 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef TPR_PLACEMENT_HH
+#define TPR_PLACEMENT_HH
+
+//
+//  Memory and CPU placement for TPR consumers.
+//
+//  The NUMA node of the TPR is found through sysfs from the device node;
+//  reader threads can be pinned to that node's CPUs, and buffers then
+//  allocated with allocLocal() are first touched there.
+//
+//  Device regions may be mapped at a huge page aligned address with
+//  MADV_HUGEPAGE, which lets a driver that supports huge mappings use
+//  them; the page size actually used is read back from /proc/self/smaps.
+//
+#include <stdint.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#include <string>
+#include <vector>
+
+namespace Tpr {
+
+  class TprPlacement {
+  public:
+    enum MapFlags { HugePages=1, Populate=2 };
+  public:
+    //  dev is a device node of the TPR (e.g. /dev/tpra)
+    TprPlacement(const char* dev);
+  public:
+    int      node () const { return _node; }    // -1 if unknown
+    const std::vector<unsigned>& cpus() const { return _cpus; }
+    //  Pin a thread to the device's node; returns 0, or <0 if unknown/failed
+    int      pinThread(pthread_t t) const;
+    int      pinThread() const { return pinThread(pthread_self()); }
+    void     report   (FILE*) const;
+  public:
+    //  mmap a device region with the given flags; 0 on failure
+    static void*    map     (int fd, size_t len, int prot, unsigned flags);
+    //  Anonymous memory, touched by the calling thread (pin it first)
+    static void*    allocLocal(size_t len, bool hugePages);
+    static void     freeLocal (void*, size_t len, bool hugePages);
+    //  Kernel page size backing addr, in bytes (0 if not found)
+    static unsigned pageSize(const void* addr);
+    //  NUMA node holding the page at addr (-1 if unknown)
+    static int      nodeOf  (const void* addr);
+  private:
+    std::string           _dev;
+    int                   _node;
+    std::vector<unsigned> _cpus;
+  };
+};
+
+#endif
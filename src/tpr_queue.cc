@@ -0,0 +1,234 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "tpr_queue.hh"
+#include "tpr_placement.hh"
+
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+
+//  Longer than the spacing of events at the base rate (1.08 us)
+static const unsigned DEFAULT_SPIN_NS = 20000;
+//  Sleep step when there is no device to block on
+static const unsigned SLEEP_NS        = 100000;
+
+using namespace Tpr;
+
+static int64_t _now()
+{
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return int64_t(t.tv_sec)*1000000000LL + t.tv_nsec;
+}
+
+//  Milliseconds left before deadline; -1 for no deadline
+static int _remaining(int64_t deadline)
+{
+  if (deadline < 0)
+    return -1;
+  int64_t ns = deadline - _now();
+  return ns > 0 ? int((ns+999999)/1000000) : 0;
+}
+
+TprQueueReader::TprQueueReader(char tprid, unsigned channel, unsigned mapFlags) :
+  _fd      (-1),
+  _ch      (channel),
+  _q       (0),
+  _rp      (0),
+  _overruns(0),
+  _spinNs  (DEFAULT_SPIN_NS),
+  _blocks  (0)
+{
+  if (channel >= MOD_SHARED) {
+    fprintf(stderr,"TprQueueReader: channel %u out of range\n",channel);
+    return;
+  }
+
+  char dev[32];
+  sprintf(dev,"/dev/tpr%c%x",tprid,channel);
+
+  _fd = open(dev, O_RDONLY);
+  if (_fd<0) {
+    perror("TprQueueReader: could not open");
+    return;
+  }
+
+  void* ptr = TprPlacement::map(_fd, sizeof(TprQueues), PROT_READ, mapFlags);
+  if (!ptr) {
+    close(_fd);
+    _fd = -1;
+    return;
+  }
+
+  _q = reinterpret_cast<const TprQueues*>(ptr);
+  //  Start with the next message
+  skip();
+}
+
+TprQueueReader::TprQueueReader(const TprQueues& q, unsigned channel) :
+  _fd      (-1),
+  _ch      (channel),
+  _q       (&q),
+  _rp      (0),
+  _overruns(0),
+  _spinNs  (DEFAULT_SPIN_NS),
+  _blocks  (0)
+{
+  skip();
+}
+
+TprQueueReader::~TprQueueReader()
+{
+  if (_q && _fd>=0)
+    munmap(const_cast<TprQueues*>(_q), sizeof(TprQueues));
+  if (_fd>=0)
+    close(_fd);
+}
+
+int TprQueueReader::wait(int timeout)
+{
+  if (pending())
+    return 1;
+
+  int64_t t0 = _now();
+  while(_now() - t0 < _spinNs) {
+    for(unsigned i=0; i<64; i++)
+      if (pending())
+        return 1;
+  }
+
+  int64_t deadline = timeout < 0 ? -1 : t0 + int64_t(timeout)*1000000LL;
+
+  if (_fd < 0) {
+    //  Following queues mapped elsewhere; nothing to block on
+    timespec ts = { 0, SLEEP_NS };
+    while(!pending()) {
+      if (_remaining(deadline)==0)
+        return 0;
+      nanosleep(&ts, 0);
+    }
+    return 1;
+  }
+
+  while(1) {
+    pollfd pfd;
+    pfd.fd      = _fd;
+    pfd.events  = POLLIN;
+    pfd.revents = 0;
+    _blocks++;
+    int r = ::poll(&pfd, 1, _remaining(deadline));
+    if (r < 0) {
+      if (errno==EINTR)
+        continue;
+      perror("TprQueueReader: poll");
+      return -1;
+    }
+    if (pending())
+      return 1;
+    if (r == 0)
+      return 0;
+    //  Woken for entries already consumed
+    rearm();
+  }
+}
+
+void TprQueueReader::rearm()
+{
+  pollfd pfd;
+  pfd.fd      = _fd;
+  pfd.events  = POLLIN;
+  pfd.revents = 0;
+  if (_fd >= 0 && ::poll(&pfd, 1, 0) > 0) {
+    char buff[32];
+    if (::read(_fd, buff, sizeof(buff)) < 0)
+      perror("TprQueueReader: read");
+  }
+}
+
+TprWaitSet::TprWaitSet() :
+  _epfd  (epoll_create1(0)),
+  _spinNs(DEFAULT_SPIN_NS)
+{
+  if (_epfd < 0)
+    perror("TprWaitSet: epoll_create1");
+}
+
+TprWaitSet::~TprWaitSet()
+{
+  if (_epfd >= 0)
+    close(_epfd);
+}
+
+int TprWaitSet::add(TprQueueReader& r)
+{
+  if (_epfd < 0 || r.fd() < 0) {
+    fprintf(stderr,"TprWaitSet: reader of channel %u has no device\n",r.channel());
+    return -1;
+  }
+
+  epoll_event ev;
+  ev.events   = EPOLLIN;
+  ev.data.ptr = &r;
+  if (epoll_ctl(_epfd, EPOLL_CTL_ADD, r.fd(), &ev) < 0) {
+    perror("TprWaitSet: epoll_ctl");
+    return -1;
+  }
+
+  if (_readers.empty() || r.spinBudget() < _spinNs)
+    _spinNs = r.spinBudget();
+  _readers.push_back(&r);
+  return 0;
+}
+
+unsigned TprWaitSet::_poll(TprQueueReader** ready, unsigned maxReady) const
+{
+  unsigned n = 0;
+  for(unsigned i=0; i<_readers.size() && n<maxReady; i++)
+    if (_readers[i]->pending())
+      ready[n++] = _readers[i];
+  return n;
+}
+
+int TprWaitSet::wait(TprQueueReader** ready, unsigned maxReady, int timeout)
+{
+  unsigned n;
+  int64_t t0 = _now();
+  do {
+    if ((n = _poll(ready, maxReady)))
+      return n;
+  } while(_now() - t0 < _spinNs);
+
+  int64_t deadline = timeout < 0 ? -1 : t0 + int64_t(timeout)*1000000LL;
+
+  epoll_event events[MOD_SHARED];
+  while(1) {
+    int r = epoll_wait(_epfd, events, MOD_SHARED, _remaining(deadline));
+    if (r < 0) {
+      if (errno==EINTR)
+        continue;
+      perror("TprWaitSet: epoll_wait");
+      return -1;
+    }
+    for(int i=0; i<r; i++) {
+      TprQueueReader* q = reinterpret_cast<TprQueueReader*>(events[i].data.ptr);
+      if (!q->pending())
+        q->rearm();
+    }
+    if ((n = _poll(ready, maxReady)))
+      return n;
+    if (r == 0)
+      return 0;
+  }
+}
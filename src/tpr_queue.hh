@@ -0,0 +1,198 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef TPR_QUEUE_HH
+#define TPR_QUEUE_HH
+
+//
+//  Reader of the TPR driver's shared-memory queues (tprsh.hh).
+//
+//  The driver appends each message to allq (indexed by gwp), then records
+//  its allq index in allrp[ch] and advances allwp[ch].  A reader keeps its
+//  own read pointer, so any number of readers may follow one channel; the
+//  fast path is loads from the mapping only, with no locks or syscalls.
+//
+//  The driver writes slot (pointer & mask) before advancing the pointer,
+//  so the slot MAX_TPR_ALLQ behind a pointer is the one being rewritten.
+//  Two ways to fall behind are detected:
+//    - allwp[ch] MAX_TPR_ALLQ or more ahead: the index ring wrapped.
+//      poll() skips to the oldest index that cannot be in rewrite.
+//    - gwp MAX_TPR_ALLQ or more ahead of an entry: the entry itself
+//      was reused (allq is shared by all channels).  Check with intact()
+//      after using the entry, or in bulk with release().
+//
+//  wait() spins on allwp for up to spinBudget() nanoseconds, then blocks in
+//  poll() on the channel's device fd until the driver's wakeup.  High-rate
+//  consumers keep a spin budget longer than the event spacing and never
+//  block; low-rate consumers set it to zero and sleep.  fd() may also be
+//  registered with epoll directly (see TprWaitSet).
+//
+#include <stdint.h>
+
+#include <vector>
+
+#include "tprsh.hh"
+
+namespace Tpr {
+
+  class TprQueueReader {
+  public:
+    //  Opens /dev/tpr<id><channel> and maps its queues read-only;
+    //  mapFlags are TprPlacement::MapFlags
+    TprQueueReader(char tprid, unsigned channel, unsigned mapFlags=0);
+    //  Follows a channel of queues mapped elsewhere (e.g. shared by
+    //  several readers of one process)
+    TprQueueReader(const TprQueues&, unsigned channel);
+    ~TprQueueReader();
+  public:
+    //  A run of entries [first,last) in the channel's index ring
+    class Batch {
+    public:
+      class iterator {
+      public:
+        iterator(const TprQueues* q, unsigned ch, int64_t i) :
+          _q(q), _ch(ch), _i(i), _ip(-1) {}
+      public:
+        const TprEntry& operator* () const { return _q->allq[index() & (MAX_TPR_ALLQ-1)]; }
+        const TprEntry* operator->() const { return &**this; }
+        iterator&       operator++() { ++_i; _ip = -1; return *this; }
+        bool operator!=(const iterator& o) const { return _i!=o._i; }
+        bool operator==(const iterator& o) const { return _i==o._i; }
+        //  Global (unmasked) allq index of this entry.  Read from the index
+        //  ring once and kept, so intact() checks the entry that was read.
+        int64_t         index() const
+        {
+          if (_ip < 0)
+            _ip = __atomic_load_n(&_q->allrp[_ch].idx[_i & (MAX_TPR_ALLQ-1)], __ATOMIC_ACQUIRE);
+          return _ip;
+        }
+        //  Position in the channel's index ring
+        int64_t         position() const { return _i; }
+      private:
+        const TprQueues* _q;
+        unsigned         _ch;
+        int64_t          _i;
+        mutable int64_t  _ip;  // <0 until read
+      };
+    public:
+      Batch(const TprQueues* q, unsigned ch, int64_t first, int64_t last) :
+        _q(q), _ch(ch), _first(first), _last(last) {}
+    public:
+      iterator begin() const { return iterator(_q,_ch,_first); }
+      iterator end  () const { return iterator(_q,_ch,_last); }
+      unsigned size () const { return unsigned(_last-_first); }
+      bool     empty() const { return _last==_first; }
+      int64_t  first() const { return _first; }
+      int64_t  last () const { return _last; }
+    private:
+      const TprQueues* _q;
+      unsigned         _ch;
+      int64_t          _first;
+      int64_t          _last;
+    };
+  public:
+    bool     isOpen () const { return _q!=0; }
+    int      fd     () const { return _fd; }
+    unsigned channel() const { return _ch; }
+    const TprQueues& queues() const { return *_q; }
+  public:
+    //  Entries written since the last release(), at most maxEntries;
+    //  empty if the reader is not open.  The other accessors require
+    //  isOpen().
+    Batch    poll   (unsigned maxEntries=MAX_TPR_ALLQ)
+    {
+      if (!_q)
+        return Batch(_q, _ch, _rp, _rp);
+      int64_t wp = __atomic_load_n(&_q->allwp[_ch], __ATOMIC_ACQUIRE);
+      if (wp - _rp >= MAX_TPR_ALLQ) {
+        _overruns += (wp - MAX_TPR_ALLQ + 1) - _rp;
+        _rp = wp - MAX_TPR_ALLQ + 1;
+      }
+      int64_t last = wp - _rp > maxEntries ? _rp + maxEntries : wp;
+      return Batch(_q, _ch, _rp, last);
+    }
+    //  True if neither the entry nor its slot in the index ring has been
+    //  reused by the driver; call after reading the entry's contents
+    bool     intact (const Batch::iterator& it) const
+    {
+      int64_t ip  = it.index();
+      int64_t wp  = __atomic_load_n(&_q->allwp[_ch], __ATOMIC_ACQUIRE);
+      int64_t gwp = __atomic_load_n(&_q->gwp, __ATOMIC_ACQUIRE);
+      return wp - it.position() < MAX_TPR_ALLQ && gwp - ip < MAX_TPR_ALLQ;
+    }
+    //  Advance past the batch.  Returns the number of its entries that
+    //  may have been reused while in use (also added to overruns()).
+    unsigned release(const Batch& b)
+    {
+      unsigned lost = 0;
+      if (!b.empty()) {
+        //  The oldest entry is the first to be reused
+        for(Batch::iterator it=b.begin(); it!=b.end(); ++it) {
+          if (intact(it))
+            break;
+          lost++;
+        }
+      }
+      _overruns += lost;
+      _rp = b.last();
+      return lost;
+    }
+    //  True if entries are waiting
+    bool     pending() const { return _q && __atomic_load_n(&_q->allwp[_ch], __ATOMIC_ACQUIRE) != _rp; }
+    //  Wait for entries; timeout in ms (<0 waits forever).  Returns 1 if
+    //  entries are waiting, 0 on timeout, <0 on error.
+    int      wait   (int timeout=-1);
+    //  Nanoseconds to spin before blocking
+    void     spinBudget(unsigned ns) { _spinNs = ns; }
+    unsigned spinBudget() const { return _spinNs; }
+    //  Count of waits that blocked in the driver
+    uint64_t blocks () const { return _blocks; }
+    //  Clear the driver's wakeup after poll() on fd() reported readable
+    void     rearm  ();
+    //  Discard everything queued so far
+    void     skip   () { _rp = __atomic_load_n(&_q->allwp[_ch], __ATOMIC_ACQUIRE); }
+    uint64_t overruns() const { return _overruns; }
+    bool     fifoFull() const { return _q->fifofull; }
+  private:
+    TprQueueReader(const TprQueueReader&);
+    TprQueueReader& operator=(const TprQueueReader&);
+  private:
+    int              _fd;
+    unsigned         _ch;
+    const TprQueues* _q;
+    int64_t          _rp;
+    uint64_t         _overruns;
+    unsigned         _spinNs;
+    uint64_t         _blocks;
+  };
+
+  //  Blocks on several channels at once with epoll
+  class TprWaitSet {
+  public:
+    TprWaitSet();
+    ~TprWaitSet();
+  public:
+    int      add   (TprQueueReader&);
+    //  Spin over all readers for up to the smallest spin budget, then block.
+    //  Fills ready[] with readers that have entries; returns their number,
+    //  0 on timeout, <0 on error.
+    int      wait  (TprQueueReader** ready, unsigned maxReady, int timeout=-1);
+  private:
+    unsigned _poll (TprQueueReader** ready, unsigned maxReady) const;
+  private:
+    TprWaitSet(const TprWaitSet&);
+    TprWaitSet& operator=(const TprWaitSet&);
+  private:
+    int                          _epfd;
+    std::vector<TprQueueReader*> _readers;
+    unsigned                     _spinNs;
+  };
+};
+
+#endif
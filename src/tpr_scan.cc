@@ -31,6 +31,13 @@ public:
   void     set(unsigned n) { _ramAddr = n&0x1ff; }
   unsigned scan0   () const { return unsigned(_ramData0)&0x1ffff; }
   unsigned scan1   () const { return unsigned(_ramData1)&0x1ffff; }
+  //  Both scan words in one request; returns a Reg::Status, and zeros
+  //  on failure
+  int      scan    (unsigned& v0, unsigned& v1) const
+  { uint32_t v[2] = {0,0};
+    int r = _ramData0.read(v,2);
+    v0 = v[0]&0x1ffff; v1 = v[1]&0x1ffff;
+    return r; }
 private:
   uint32_t       _rsvd[0x28>>2];
   Pds::Cphw::Reg _rescan;
@@ -88,7 +95,8 @@ int main(int argc, char** argv) {
     }
   }
 
-  Pds::Cphw::Reg::set(ip, 8192, 0);
+  if (Pds::Cphw::Reg::set(ip, 8192, 0) < 0)
+    return 1;
 
   FILE* f = fopen(fname,"w");
 
@@ -102,8 +110,14 @@ int main(int argc, char** argv) {
 #if 1
   for(unsigned i=0; i<512; i++) {
     p->set(i);
-    unsigned v0 = p->scan0();
-    unsigned v1 = p->scan1();
+    unsigned v0, v1;
+    if (p->scan(v0,v1) < 0) {
+      Pds::Cphw::Reg::Stats s;
+      Pds::Cphw::Reg::stats(s);
+      printf("PhaseMsmt: register read failed at 0x%x (%llu retries, %llu timeouts)\n",
+             i, (unsigned long long)s.retries, (unsigned long long)s.timeouts);
+      break;
+    }
     fprintf(f,"{ 0x%x, 0x%x, 0x%x},\n", i, v0, v1);
     printf("{ 0x%x, 0x%x, 0x%x},\n", i, v0, v1);
   }
@@ -0,0 +1,111 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef TPR_SEGMENTS_HH
+#define TPR_SEGMENTS_HH
+
+//
+//  Iteration over the segment chain of a TPR message (tprdata.hh) in
+//  place.  Each step looks the segment size up by type and checks it
+//  against the bytes left in the buffer; the chain ends at an _End
+//  header, an unknown type, or a segment that would run past the buffer.
+//
+//    for(const Tpr::Segment& s : Tpr::SegmentRange(entry))
+//      if (const Tpr::Event* e = s.event())
+//        ...
+//
+#include <stdint.h>
+#include <stddef.h>
+
+#include "tprdata.hh"
+#include "tprsh.hh"
+
+namespace Tpr {
+
+  //  The type field also carries the source (bit 6) and drop (bit 7)
+  //  flags; compare types through this
+  inline unsigned segmentType(const SegmentHeader& h) { return h.type()&0xf; }
+
+  //  Size of a segment by type; 0 for _End and unknown types
+  inline unsigned segmentSize(unsigned type)
+  {
+    static const uint16_t _sizes[16] = { sizeof(Event), sizeof(BsaControl), sizeof(BsaChannel),
+                                         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    return _sizes[type&0xf];
+  }
+
+  //  A view of one segment within the buffer
+  class Segment : public SegmentHeader {
+  public:
+    unsigned          size      () const { return segmentSize(type()); }
+    const Event*      event     () const { return segmentType(*this)==_Event      ? reinterpret_cast<const Event*     >(this) : 0; }
+    const BsaControl* bsaControl() const { return segmentType(*this)==_BsaControl ? reinterpret_cast<const BsaControl*>(this) : 0; }
+    const BsaChannel* bsaChannel() const { return segmentType(*this)==_BsaChannel ? reinterpret_cast<const BsaChannel*>(this) : 0; }
+  };
+
+  class SegmentRange {
+  public:
+    class iterator {
+    public:
+      iterator(const char* p, const char* end) : _p(p), _end(end) { _check(); }
+    public:
+      const Segment& operator* () const { return *reinterpret_cast<const Segment*>(_p); }
+      const Segment* operator->() const { return reinterpret_cast<const Segment*>(_p); }
+      iterator&      operator++()
+      {
+        _p += segmentSize(_type());
+        _check();
+        return *this;
+      }
+      bool operator!=(const iterator& o) const { return _p!=o._p; }
+      bool operator==(const iterator& o) const { return _p==o._p; }
+      //  Byte offset of this segment from the start of the buffer
+      size_t         offset(const void* base) const { return _p-static_cast<const char*>(base); }
+    private:
+      unsigned _type() const { return segmentType(*reinterpret_cast<const Segment*>(_p)); }
+      //  Park at end unless a whole, known segment remains
+      void     _check()
+      {
+        size_t rem = _end - _p;
+        if (rem < sizeof(SegmentHeader) || rem < segmentSize(_type()) || !segmentSize(_type()))
+          _p = _end;
+      }
+    private:
+      const char* _p;
+      const char* _end;
+    };
+  public:
+    SegmentRange(const void* buf, size_t len) :
+      _begin(static_cast<const char*>(buf)),
+      _end  (_begin+len) {}
+    //  The driver rewrites entries in place; check TprQueueReader::intact()
+    //  after decoding one from the shared queues
+    SegmentRange(const TprEntry& e) :
+      _begin(reinterpret_cast<const char*>(const_cast<const uint32_t*>(e.word))),
+      _end  (_begin+sizeof(e.word)) {}
+  public:
+    iterator begin() const { return iterator(_begin,_end); }
+    iterator end  () const { return iterator(_end  ,_end); }
+    //  True if the chain ends at an _End header rather than an unknown
+    //  type or the end of the buffer (walks the chain)
+    bool     complete() const
+    {
+      const char* p = _begin;
+      for(iterator it=begin(); it!=end(); ++it)
+        p += it->size();
+      return size_t(_end-p) >= sizeof(SegmentHeader) &&
+        segmentType(*reinterpret_cast<const SegmentHeader*>(p))==_End;
+    }
+  private:
+    const char* _begin;
+    const char* _end;
+  };
+};
+
+#endif
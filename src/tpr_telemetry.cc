@@ -0,0 +1,153 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "tpr_telemetry.hh"
+#include "tpr_segments.hh"
+#include "log_hist.hh"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//  Timing timestamps count from the EPICS epoch (1990)
+static const int64_t EPICS_EPOCH_SEC = 631152000;
+
+using namespace Tpr;
+
+static int64_t _now()
+{
+  timespec t;
+  clock_gettime(CLOCK_REALTIME, &t);
+  return int64_t(t.tv_sec)*1000000000LL + t.tv_nsec;
+}
+
+double TprChannelStats::percentileUs(double f) const
+{
+  return Cphw::LogHist::percentileUs(latHist, NBINS, latSamples, latMaxNs, f);
+}
+
+TprTelemetry::TprTelemetry(char tprid, bool writer) :
+  _page  (0),
+  _writer(writer)
+{
+  memset(_rateNs    , 0, sizeof(_rateNs));
+  memset(_rateEvents, 0, sizeof(_rateEvents));
+
+  char name[32];
+  sprintf(name,"/tpr%c_telemetry",tprid);
+
+  int fd = shm_open(name, writer ? (O_RDWR|O_CREAT) : O_RDONLY, 0666);
+  if (fd < 0) {
+    perror("TprTelemetry: shm_open");
+    return;
+  }
+
+  if (writer) {
+    //  shm_open is subject to the umask; let any consumer attach
+    fchmod(fd, 0666);
+    if (ftruncate(fd, sizeof(TprTelemetryPage)) < 0) {
+      perror("TprTelemetry: ftruncate");
+      close(fd);
+      return;
+    }
+  }
+
+  void* ptr = mmap(0, sizeof(TprTelemetryPage),
+                   writer ? (PROT_READ|PROT_WRITE) : PROT_READ,
+                   MAP_SHARED, fd, 0);
+  close(fd);
+  if (ptr == MAP_FAILED) {
+    perror("TprTelemetry: mmap");
+    return;
+  }
+
+  _page = reinterpret_cast<TprTelemetryPage*>(ptr);
+  if (writer && _page->magic != TprTelemetryPage::MAGIC) {
+    _page->version = TprTelemetryPage::VERSION;
+    _page->magic   = TprTelemetryPage::MAGIC;
+  }
+  else if (!writer && (_page->magic   != TprTelemetryPage::MAGIC ||
+                       _page->version != TprTelemetryPage::VERSION)) {
+    fprintf(stderr,"TprTelemetry: %s has no telemetry page\n",name);
+    munmap(ptr, sizeof(TprTelemetryPage));
+    _page = 0;
+  }
+}
+
+TprTelemetry::~TprTelemetry()
+{
+  if (_page)
+    munmap(_page, sizeof(TprTelemetryPage));
+}
+
+void TprTelemetry::attach(unsigned channel)
+{
+  if (!_page || !_writer || channel >= MOD_SHARED)
+    return;
+  TprChannelStats& s = _page->channel[channel];
+  memset(&s, 0, sizeof(s));
+  s.pid = getpid();
+  _rateNs    [channel] = _now();
+  _rateEvents[channel] = 0;
+}
+
+void TprTelemetry::record(const TprQueueReader& r, const TprQueueReader::Batch& b)
+{
+  unsigned ch = r.channel();
+  if (!_page || !_writer || ch >= MOD_SHARED || b.empty())
+    return;
+
+  TprChannelStats& s   = _page->channel[ch];
+  int64_t          now = _now();
+  int64_t          wp  = __atomic_load_n(&r.queues().allwp[ch], __ATOMIC_ACQUIRE);
+  uint64_t         lag = wp - b.first();
+
+  uint64_t early = 0, nlat = 0, latNs = 0, latMax = s.latMaxNs;
+  for(TprQueueReader::Batch::iterator it=b.begin(); it!=b.end(); ++it) {
+    SegmentRange           range(*it);
+    SegmentRange::iterator seg = range.begin();
+    const Event* e = seg != range.end() ? seg->event() : 0;
+    if (!e)
+      continue;
+    int64_t ts = (int64_t(e->timeStamp>>32) + EPICS_EPOCH_SEC)*1000000000LL +
+      int64_t(e->timeStamp&0xffffffff);
+    int64_t dt = now - ts;
+    if (dt < 0) {
+      early++;
+      dt = 0;
+    }
+    nlat  ++;
+    latNs += dt;
+    if (uint64_t(dt) > latMax)
+      latMax = dt;
+    s.latHist[Cphw::LogHist::bin(dt, TprChannelStats::NBINS)]++;
+  }
+
+  s.events     += b.size();
+  s.batches    ++;
+  s.overruns    = r.overruns();
+  s.fifoFull    = r.fifoFull();
+  s.lagSum     += lag;
+  if (lag > s.lagMax)
+    s.lagMax    = lag;
+  s.early      += early;
+  s.latSamples += nlat;
+  s.latNs      += latNs;
+  s.latMaxNs    = latMax;
+
+  if (now - _rateNs[ch] >= 1000000000LL) {
+    s.rate = double(s.events - _rateEvents[ch])*1.e9/double(now - _rateNs[ch]);
+    _rateNs    [ch] = now;
+    _rateEvents[ch] = s.events;
+  }
+}
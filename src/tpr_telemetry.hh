@@ -0,0 +1,83 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef TPR_TELEMETRY_HH
+#define TPR_TELEMETRY_HH
+
+//
+//  Consumer-side statistics of the TPR queues, kept in a shared-memory
+//  page (/dev/shm/tpr<id>_telemetry) for an external monitor (tpr_monitor).
+//
+//  A consumer calls record() once per batch; the cost is one clock read
+//  per batch, a decode of each entry's first segment for its event
+//  timestamp, and plain stores to its channel's slot.  Each channel has
+//  one reporting consumer; the monitor only reads.
+//
+#include <stdint.h>
+
+#include "tprsh.hh"
+#include "tpr_queue.hh"
+
+namespace Tpr {
+
+  class TprChannelStats {
+  public:
+    //  Latency bins as Cphw::LogHist
+    enum { NBINS = 24 };
+  public:
+    double   percentileUs(double f) const;  // upper edge of the bin
+  public:
+    int32_t  pid;          // reporting consumer; 0 = none
+    uint32_t fifoFull;     // driver's fifofull at the last batch
+    uint64_t events;       // entries consumed
+    uint64_t batches;
+    uint64_t overruns;     // entries lost (TprQueueReader::overruns)
+    uint64_t lagSum;       // entries outstanding, summed over batches
+    uint64_t lagMax;
+    uint64_t early;        // event timestamps ahead of the local clock
+    uint64_t latSamples;   // events with a timestamp
+    uint64_t latNs;        // summed latency
+    uint64_t latMaxNs;
+    uint64_t latHist[NBINS];
+    double   rate;         // events/sec over the last second
+  };
+
+  class TprTelemetryPage {
+  public:
+    enum { MAGIC = 0x54505254, VERSION = 1 };
+    uint32_t        magic;
+    uint32_t        version;
+    TprChannelStats channel[MOD_SHARED];
+  };
+
+  class TprTelemetry {
+  public:
+    //  Consumers create the page read-write; monitors map it read-only
+    TprTelemetry(char tprid, bool writer=true);
+    ~TprTelemetry();
+  public:
+    bool     isOpen() const { return _page!=0; }
+    const TprTelemetryPage& page() const { return *_page; }
+  public:
+    //  Claim a channel's slot and clear it
+    void     attach(unsigned channel);
+    //  Account for a batch from the reader; call before release()
+    void     record(const TprQueueReader&, const TprQueueReader::Batch&);
+  private:
+    TprTelemetry(const TprTelemetry&);
+    TprTelemetry& operator=(const TprTelemetry&);
+  private:
+    TprTelemetryPage* _page;
+    bool              _writer;
+    int64_t           _rateNs    [MOD_SHARED];
+    uint64_t          _rateEvents[MOD_SHARED];
+  };
+};
+
+#endif
@@ -22,6 +22,8 @@
 
 #include "tpr.hh"
 #include "tprsh.hh"
+#include "tpr_config.hh"
+#include "tpr_placement.hh"
 
 #include <string>
 #include <vector>
@@ -36,6 +38,9 @@ extern int optind;
 static void usage(const char* p) {
   printf("Usage: %s [options]\n",p);
   printf("Options: -d <a..z> : /dev/tpr<arg>[0..a]\n");
+  printf("         -c <file>  : load the full channel/trigger table from file\n");
+  printf("         -w <file>  : save the resulting table to file\n");
+  printf("         -v         : report the NUMA placement and register page size\n");
   printf("         -f <output>,<delay>,<width>,<fixed rate>[,<polarity>]      : trigger on fixed rate marker\n");
   printf("         -a <output>,<delay>,<width>,<ac rate>,<tsmask>[,<polarity>] : trigger on AC rate marker\n");
   printf("         -s <output>,<delay>,<width>,<seq>,<bit>[,<polarity>]        : trigger on sequence marker\n");
@@ -108,20 +113,12 @@ public:
   PulseConfig pulse;
 };
 
-static void set_trigger( TprBase&           base,
+static void set_trigger( TprConfig&         config,
                          const PulseConfig& c, 
                          unsigned           evtSel)
 {
-  unsigned udel = c.delay*CLK_FREQ*1.e-9;
-  unsigned uwid = c.width*CLK_FREQ*1.e-9;
-  unsigned utap = (c.delay*CLK_FREQ*1.e-9 - double(udel))*63;
-  base.channel[c.output].evtSel  = evtSel;
-  base.channel[c.output].control = 5;
-  base.trigger[c.output].control = 0;
-  base.trigger[c.output].delay    = udel;
-  base.trigger[c.output].delayTap = utap;
-  base.trigger[c.output].width    = uwid;
-  base.trigger[c.output].control  = (c.output&0xffff) | (1<<31) | (c.polarity ? (1<<16) : 0);
+  config.setChannel(c.output, evtSel);
+  config.setTrigger(c.output, c.output, c.delay, c.width, c.polarity);
 }
 
 static const char* rateStr(unsigned v);
@@ -130,6 +127,9 @@ int main(int argc, char** argv) {
 
   extern char* optarg;
   char tprid='a';
+  const char* cfile = 0;
+  const char* wfile = 0;
+  bool lVerbose = false;
 
   int c;
   bool lUsage  = false;
@@ -138,7 +138,7 @@ int main(int argc, char** argv) {
   std::vector<SeqConfig>       seq;
   std::vector<BeamConfig>      beam;
 
-  while ( (c=getopt( argc, argv, "f:a:s:d:b:h?")) != EOF ) {
+  while ( (c=getopt( argc, argv, "f:a:s:d:b:c:w:vh?")) != EOF ) {
     switch(c) {
     case 'd':
       tprid  = optarg[0];
@@ -147,6 +147,15 @@ int main(int argc, char** argv) {
         lUsage = true;
       }
       break;
+    case 'c':
+      cfile = optarg;
+      break;
+    case 'w':
+      wfile = optarg;
+      break;
+    case 'v':
+      lVerbose = true;
+      break;
     case 'f':
       fixedRate.push_back(FixedRateConfig(optarg));
       break;
@@ -196,6 +205,11 @@ int main(int argc, char** argv) {
       return -2;
     }
 
+    if (lVerbose) {
+      TprPlacement(dev).report(stdout);
+      printf("Registers mapped with %u kB pages\n", TprPlacement::pageSize(ptr)/1024);
+    }
+
     TprReg& reg = *reinterpret_cast<TprReg*>(ptr);
     printf("BuildStamp: %s\n", reg.version.buildStamp().c_str());
 
@@ -207,22 +221,43 @@ int main(int argc, char** argv) {
     reg.tpr.clkSel(1);
     reg.tpr.rxPolarity(false);
 
+    //  Start from the file's table or the current settings
+    TprConfig config(reg.base);
+    if (cfile && config.load(cfile) < 0)
+      return -3;
+
     for(unsigned i=0; i<fixedRate.size(); i++)
-      set_trigger( reg.base,
+      set_trigger( config,
                    fixedRate[i].pulse, 
                    (2<<29) | (0<<11) | fixedRate[i].rate);
     // for(unsigned i=0; i<acRate.size(); i++)
-    //   set_trigger( reg.base,
+    //   set_trigger( config,
     // acRate   [i].pulse, 
     // (2<<29) | (1<<11) | acRate[i].rate);
     for(unsigned i=0; i<seq.size(); i++)
-      set_trigger( reg.base,
+      set_trigger( config,
                    seq      [i].pulse, 
                    (2<<29) | (2<<11) | ((seq[i].seq&0x1f)<<4) | (seq[i].bit&0xf) );
     for(unsigned i=0; i<beam.size(); i++)
-      set_trigger( reg.base,
+      set_trigger( config,
                    beam     [i].pulse, 
-                   (0<<29) | (0x1<<13));  // beam to dest 0
+                   TprConfig::beam(0));
+
+    printf("Changed %u outputs\n", config.apply(reg.base));
+
+    if (wfile) {
+      FILE* f = fopen(wfile,"w");
+      if (f) {
+        config.save(f);
+        fclose(f);
+        //  The file must reload as the same register values
+        TprConfig check;
+        if (check.load(wfile) < 0 || !(check==config))
+          fprintf(stderr,"%s does not reload as the applied table\n", wfile);
+      }
+      else
+        perror("Could not open output");
+    }
 
     //
     //  Dump the status of all trigger channels
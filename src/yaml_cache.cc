@@ -0,0 +1,344 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#include "yaml_cache.hh"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <libgen.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include <yaml-cpp/yaml.h>
+
+using namespace Cphw;
+
+//  FNV-1a
+static uint64_t _hash(uint64_t h, const void* p, size_t n)
+{
+  const uint8_t* b = reinterpret_cast<const uint8_t*>(p);
+  for(size_t i=0; i<n; i++) {
+    h ^= b[i];
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+static uint64_t _hash(uint64_t h, const std::string& s)
+{
+  return _hash(h, s.data(), s.size()+1);
+}
+
+static std::string _dirname(const std::string& path)
+{
+  std::vector<char> b(path.begin(), path.end());
+  b.push_back(0);
+  return std::string(dirname(b.data()));
+}
+
+//  Identity of a source file; a change to any of them rebuilds the cache
+class Source {
+public:
+  std::string path;
+  int64_t     mtimeNs;
+  int64_t     size;
+};
+
+static bool _stat(const char* path, Source& s)
+{
+  struct stat st;
+  if (stat(path, &st) < 0)
+    return false;
+  s.path    = path;
+  s.mtimeNs = int64_t(st.st_mtim.tv_sec)*1000000000LL + st.st_mtim.tv_nsec;
+  s.size    = st.st_size;
+  return true;
+}
+
+//  As scripts/yaml_regmap.py: included text precedes the including file,
+//  and each file is expanded once.  Each file is stat'ed before it is
+//  read, so a later edit always shows in the cache key.
+static bool _expand(const std::string& fname, std::vector<Source>& done,
+                    std::string& text)
+{
+  char rpath[PATH_MAX];
+  if (!realpath(fname.c_str(), rpath)) {
+    perror(fname.c_str());
+    return false;
+  }
+  for(unsigned i=0; i<done.size(); i++)
+    if (done[i].path == rpath)
+      return true;
+
+  Source src;
+  if (!_stat(rpath, src)) {
+    perror(rpath);
+    return false;
+  }
+  done.push_back(src);
+
+  std::ifstream f(rpath);
+  if (!f) {
+    perror(rpath);
+    return false;
+  }
+
+  std::string body, line;
+  while(std::getline(f, line)) {
+    if (line.compare(0, 8, "#include") == 0) {
+      std::istringstream is(line.substr(8));
+      std::string inc;
+      is >> inc;
+      if (!_expand(_dirname(rpath)+"/"+inc, done, text))
+        return false;
+    }
+    else {
+      body += line;
+      body += '\n';
+    }
+  }
+  text += body;
+  return true;
+}
+
+static bool _preprocess(const char* file, std::string& text, std::vector<Source>& srcs)
+{
+  text.clear();
+  srcs.clear();
+  return _expand(file, srcs, text);
+}
+
+bool YamlCache::preprocess(const char*  file,
+                           std::string& text)
+{
+  std::vector<Source> srcs;
+  return _preprocess(file, text, srcs);
+}
+
+//  Drop the root's children that are not the first element of a path in
+//  keep.  Deeper subtrees are reached through merge keys ('<<: *anchor')
+//  shared with other parents, so they are left alone.
+static std::string _prune(const std::string& text, const char* root, const char* keep)
+{
+  std::set<std::string> names;
+  for(const char* p = keep; *p; ) {
+    size_t n = strcspn(p, ",/");
+    names.insert(std::string(p, n));
+    p += n;
+    p += strcspn(p, ",");
+    if (*p) p++;
+  }
+
+  YAML::Node doc      = YAML::Load(text);
+  YAML::Node children = doc[root]["children"];
+  if (!children.IsMap())
+    return text;
+
+  std::vector<std::string> drop;
+  for(YAML::const_iterator it=children.begin(); it!=children.end(); ++it) {
+    std::string name = it->first.as<std::string>();
+    if (names.find(name) == names.end())
+      drop.push_back(name);
+  }
+  for(unsigned i=0; i<drop.size(); i++)
+    children.remove(drop[i]);
+
+  YAML::Emitter out;
+  out << doc;
+  //  The directives are consumed by the preprocessor, except the schema
+  return std::string("#schemaversion 3.0.0\n") + out.c_str() + "\n";
+}
+
+//  $TPG_YAML_CACHE, else $XDG_CACHE_HOME/tpg or ~/.cache/tpg; empty if
+//  disabled or there is no home
+static std::string _cacheDir()
+{
+  const char* dir = getenv("TPG_YAML_CACHE");
+  if (dir)
+    return strcmp(dir,"none")==0 ? std::string() : std::string(dir);
+
+  std::string d;
+  if ((dir = getenv("XDG_CACHE_HOME")) && *dir)
+    d = dir;
+  else if ((dir = getenv("HOME")) && *dir) {
+    d = std::string(dir)+"/.cache";
+    mkdir(d.c_str(), 0700);
+  }
+  else
+    return d;
+  d += "/tpg";
+  if (mkdir(d.c_str(), 0700) < 0 && errno != EEXIST) {
+    perror(d.c_str());
+    d.clear();
+  }
+  return d;
+}
+
+//  The cache starts with the sources it was built from:
+//
+//    #yamlcache <n>
+//    #source <mtime,ns> <size> <path>     (n lines)
+//
+//  and holds the expanded document after them
+static void _header(const std::vector<Source>& srcs, std::string& h)
+{
+  char line[64];
+  snprintf(line, sizeof(line), "#yamlcache %u\n", unsigned(srcs.size()));
+  h = line;
+  for(unsigned i=0; i<srcs.size(); i++) {
+    snprintf(line, sizeof(line), "#source %lld %lld ",
+             (long long)srcs[i].mtimeNs, (long long)srcs[i].size);
+    h += line;
+    h += srcs[i].path;
+    h += '\n';
+  }
+}
+
+//  Strips the header; false unless every source is unchanged
+static bool _current(std::string& text)
+{
+  unsigned n;
+  if (sscanf(text.c_str(), "#yamlcache %u\n", &n) != 1)
+    return false;
+  size_t p = text.find('\n');
+  for(unsigned i=0; i<n; i++) {
+    if (p == std::string::npos)
+      return false;
+    size_t e = text.find('\n', ++p);
+    if (e == std::string::npos)
+      return false;
+    long long mtime, size;
+    int       off;
+    std::string l = text.substr(p, e-p);
+    if (sscanf(l.c_str(), "#source %lld %lld %n", &mtime, &size, &off) != 2)
+      return false;
+    Source s;
+    if (!_stat(l.c_str()+off, s) || s.mtimeNs != mtime || s.size != size)
+      return false;
+    p = e;
+  }
+  if (p == std::string::npos)
+    return false;
+  text.erase(0, p+1);
+  return true;
+}
+
+//  Only a regular file of ours that nobody else can write is trusted
+static bool _readCache(const char* cname, std::string& text)
+{
+  int fd = open(cname, O_RDONLY|O_NOFOLLOW|O_CLOEXEC);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  bool ok = (fstat(fd, &st) == 0 &&
+             S_ISREG(st.st_mode) &&
+             st.st_uid == geteuid() &&
+             (st.st_mode & (S_IWGRP|S_IWOTH)) == 0);
+  if (!ok)
+    fprintf(stderr,"YamlCache: %s: not trusted, rebuilding\n", cname);
+
+  text.clear();
+  char buff[4096];
+  ssize_t n;
+  while(ok && (n = read(fd, buff, sizeof(buff))) != 0) {
+    if (n < 0) {
+      perror(cname);
+      ok = false;
+    }
+    else
+      text.append(buff, n);
+  }
+  close(fd);
+  return ok;
+}
+
+//  Written aside and renamed, so concurrent tools never read a partial file
+static void _writeCache(const char* cname, const std::string& text)
+{
+  std::string tname = std::string(cname)+".XXXXXX";
+  std::vector<char> b(tname.begin(), tname.end());
+  b.push_back(0);
+  int fd = mkstemp(b.data());
+  if (fd < 0) {
+    perror(tname.c_str());
+    return;
+  }
+
+  bool ok = true;
+  for(size_t i=0; ok && i<text.size(); ) {
+    ssize_t n = write(fd, text.data()+i, text.size()-i);
+    if (n < 0)
+      ok = false;
+    else
+      i += n;
+  }
+  ok = (close(fd) == 0) && ok;
+  if (!ok || rename(b.data(), cname) < 0) {
+    perror(cname);
+    unlink(b.data());
+  }
+}
+
+Path YamlCache::load(const char*  file,
+                     const char*  root,
+                     IYamlFixup*  fixup,
+                     const char*  keep)
+{
+  std::string dir = _cacheDir();
+  char        rpath[PATH_MAX];
+  if (dir.empty() || !realpath(file, rpath))
+    return IPath::loadYamlFile(file, root, 0, fixup);
+
+  //  Keyed by what is loaded; the sources are checked from the header
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  hash = _hash(hash, std::string(rpath));
+  hash = _hash(hash, std::string(root));
+  hash = _hash(hash, std::string(keep ? keep : ""));
+
+  std::string base(file);
+  base = base.substr(base.rfind('/')+1);
+  char cname[PATH_MAX];
+  snprintf(cname, sizeof(cname), "%s/%s-%016llx", dir.c_str(), base.c_str(),
+           (unsigned long long)hash);
+
+  std::string text;
+  if (_readCache(cname, text) && _current(text)) {
+    std::istringstream is(text);
+    return IPath::loadYamlStream(is, root, _dirname(file).c_str(), fixup);
+  }
+
+  std::vector<Source> srcs;
+  if (!_preprocess(file, text, srcs))
+    return IPath::loadYamlFile(file, root, 0, fixup);
+
+  try {
+    if (keep)
+      text = _prune(text, root, keep);
+  }
+  catch(YAML::Exception& e) {
+    fprintf(stderr,"YamlCache: %s: %s\n", file, e.what());
+    return IPath::loadYamlFile(file, root, 0, fixup);
+  }
+
+  std::string header;
+  _header(srcs, header);
+  _writeCache(cname, header+text);
+
+  std::istringstream is(text);
+  return IPath::loadYamlStream(is, root, _dirname(file).c_str(), fixup);
+}
@@ -0,0 +1,47 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'tpg'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'tpg', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef Cphw_YamlCache_hh
+#define Cphw_YamlCache_hh
+
+//
+//  IPath::loadYamlFile for short-lived tools.  The '#include' tree is
+//  expanded once into a single document and the root's children not
+//  named in keep are dropped, so their transports (e.g. the strm RSSI
+//  channel) are never opened.  The result is cached under
+//  $TPG_YAML_CACHE (default $XDG_CACHE_HOME/tpg or ~/.cache/tpg; "none"
+//  disables), keyed by the file, root and keep.  It records the path,
+//  mtime and size of every included file and is loaded with
+//  IPath::loadYamlStream while they are unchanged, so a hit reads no
+//  sources.  A cache file not owned by the user, or writable by others,
+//  is rebuilt.  Fixups are applied at load, so one cache serves all
+//  targets.
+//
+#include <stdint.h>
+
+#include <string>
+
+#include <cpsw_api_user.h>
+
+namespace Cphw {
+  class YamlCache {
+  public:
+    //  keep: comma separated paths below root (only the first element of
+    //  each is used); 0 keeps everything
+    static Path load(const char*  file,
+                     const char*  root,
+                     IYamlFixup*  fixup=0,
+                     const char*  keep=0);
+    //  The expanded document; false if a file is unreadable
+    static bool preprocess(const char*  file,
+                           std::string& text);
+  };
+};
+
+#endif